@@ -1,55 +1,157 @@
 {
     "target_defaults": {
         "default_configuration": "Release",
+        "cflags!": ["-fno-exceptions"],
+        "cflags_cc!": ["-fno-exceptions"],
+        "xcode_settings": {
+            "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+        },
         "configurations": {
             "Debug": {
                 "defines": ["DEBUG"],
             },
         },
     },
+    "conditions": [
+        # The addon decodes through VideoToolbox and renders with SDL, so it
+        # only builds on macOS. The command line tools below build anywhere.
+        ["OS == 'mac'", {
+            "targets": [{
+                "target_name": "addon",
+                "cflags_cc": ["-Wall", "-Wuninitialized"],
+                "xcode_settings": {
+                    "OTHER_CFLAGS": [
+                        "-fobjc-arc", # need this to enable ARC
+                        "-std=c++17",
+                        "-stdlib=libc++",
+                        "-Wno-delete-non-virtual-dtor", # TODO cheat. Ignore a warning for now.
+                    ],
+                    "MACOSX_DEPLOYMENT_TARGET": "10.14", # Otherwise seeing an error like "was built for newer OSX version (10.14) than being linked (10.7)"
+                },
+                "sources": [
+                    "cppsrc/main.cpp",
+                    "cppsrc/h264_common.cpp",
+                    "cppsrc/h265_common.cpp",
+                    "cppsrc/nalu_rewriter.cpp",
+                    "cppsrc/decode_render.mm",
+                    "cppsrc/h264_player.mm",
+                    "cppsrc/trace.cpp",
+                    "cppsrc/shm_ring.cpp",
+                    "cppsrc/frame_loader.cpp",
+                    "cppsrc/benchmark.cpp",
+                    "cppsrc/picture_pool.cpp",
+                ],
+                "include_dirs": [
+                    "<!@(node -p \"require('node-addon-api').include\")"
+                ],
+                "dependencies": [
+                    "<!(node -p \"require('node-addon-api').gyp\")"
+                ],
+                "defines": [
+                    "NAPI_CPP_EXCEPTIONS=1",
+                ],
+                "conditions": [
+                    ["OS == 'mac'", {
+                        "libraries": [
+                            "-framework AppKit",
+                            "-framework CoreVideo",
+                            "-framework CoreMedia",
+                            "-framework CoreGraphics",
+                            "-framework VideoToolbox",
+                            "-framework AVFoundation",
+                            "/System/Library/Frameworks/ApplicationServices.framework",
+                            "<(module_root_dir)/lib/mac/libSDL2.a"
+                        ]
+                    }]
+                ]
+            }]
+        }]
+    ],
     "targets": [{
-        "target_name": "addon",
-        "cflags!": ["-fno-exceptions"],
-        "cflags_cc!": ["-fno-exceptions"],
+        # Headless end-to-end benchmark. Run
+        # build/Release/player_bench <frames dir> [--loops N] [--warmup N]
+        # [--codec h264|h265].
+        "target_name": "player_bench",
+        "type": "executable",
         "cflags_cc": ["-Wall", "-Wuninitialized"],
         "xcode_settings": {
             "OTHER_CFLAGS": [
-                "-fobjc-arc", # need this to enable ARC
                 "-std=c++17",
                 "-stdlib=libc++",
-                "-Wno-delete-non-virtual-dtor", # TODO cheat. Ignore a warning for now.
             ],
-            "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
-            "MACOSX_DEPLOYMENT_TARGET": "10.14", # Otherwise seeing an error like "was built for newer OSX version (10.14) than being linked (10.7)"
+            "MACOSX_DEPLOYMENT_TARGET": "10.14",
         },
         "sources": [
-            "cppsrc/main.cpp",
+            "cppsrc/bench_main.cpp",
+            "cppsrc/benchmark.cpp",
+            "cppsrc/frame_loader.cpp",
             "cppsrc/h264_common.cpp",
-            "cppsrc/nalu_rewriter.cpp",
-            "cppsrc/decode_render.mm",
-            "cppsrc/h264_player.mm",
+            "cppsrc/h265_common.cpp",
         ],
-        "include_dirs": [
-            "<!@(node -p \"require('node-addon-api').include\")"
+    }, {
+        # Headless trace replay, for reproducing incidents without
+        # VideoToolbox. Run build/Release/trace_replay <trace> [--speed X]
+        # [--codec h264|h265].
+        "target_name": "trace_replay",
+        "type": "executable",
+        "cflags_cc": ["-Wall", "-Wuninitialized"],
+        "xcode_settings": {
+            "OTHER_CFLAGS": [
+                "-std=c++17",
+                "-stdlib=libc++",
+            ],
+            "MACOSX_DEPLOYMENT_TARGET": "10.14",
+        },
+        "sources": [
+            "cppsrc/trace_replay.cpp",
+            "cppsrc/trace.cpp",
+            "cppsrc/h264_common.cpp",
+            "cppsrc/h265_common.cpp",
         ],
-        "dependencies": [
-            "<!(node -p \"require('node-addon-api').gyp\")"
+    }, {
+        # Bitrate, GOP and NALU statistics for frames directories and raw
+        # Annex B files. Run build/Release/stream_analyzer <input>...
+        "target_name": "stream_analyzer",
+        "type": "executable",
+        "cflags_cc": ["-Wall", "-Wuninitialized"],
+        "xcode_settings": {
+            "OTHER_CFLAGS": [
+                "-std=c++17",
+                "-stdlib=libc++",
+            ],
+            "MACOSX_DEPLOYMENT_TARGET": "10.14",
+        },
+        "sources": [
+            "cppsrc/stream_analyzer.cpp",
+            "cppsrc/frame_loader.cpp",
+            "cppsrc/h264_common.cpp",
+            "cppsrc/h265_common.cpp",
         ],
-        "defines": [
-            "NAPI_CPP_EXCEPTIONS=1",
+        "conditions": [
+            ["OS == 'linux'", {
+                "libraries": ["-lpthread"]
+            }]
+        ]
+    }, {
+        # Two-process check and throughput benchmark for the shared-memory
+        # ring. Run build/Release/shm_bench.
+        "target_name": "shm_bench",
+        "type": "executable",
+        "cflags_cc": ["-Wall", "-Wuninitialized"],
+        "xcode_settings": {
+            "OTHER_CFLAGS": [
+                "-std=c++17",
+                "-stdlib=libc++",
+            ],
+            "MACOSX_DEPLOYMENT_TARGET": "10.14",
+        },
+        "sources": [
+            "cppsrc/shm_bench.cpp",
+            "cppsrc/shm_ring.cpp",
         ],
         "conditions": [
-            ["OS == 'mac'", {
-                "libraries": [
-                    "-framework AppKit",
-                    "-framework CoreVideo",
-                    "-framework CoreMedia",
-                    "-framework CoreGraphics",
-                    "-framework VideoToolbox",
-                    "-framework AVFoundation",
-                    "/System/Library/Frameworks/ApplicationServices.framework",
-                    "<(module_root_dir)/lib/mac/libSDL2.a"
-                ]
+            ["OS == 'linux'", {
+                "libraries": ["-lrt", "-lpthread"]
             }]
         ]
     }]
@@ -0,0 +1,293 @@
+/*
+ *  Copyright (c) 2015 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ *
+ */
+
+#ifndef ANNEXB_H_
+#define ANNEXB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "codec_traits.h"
+
+namespace webrtc
+{
+
+using H264::NaluIndex;
+
+// Size of the big endian length that replaces each start code in avcc (H264)
+// and hvcc (H265) buffers. Both are called avcc below.
+const size_t kAvccHeaderByteSize = sizeof(uint32_t);
+
+// Helper class for reading NALUs from an RTP Annex B buffer.
+template <typename Traits>
+class AnnexBBufferReaderT final
+{
+public:
+  typedef typename Traits::NaluType NaluType;
+
+  AnnexBBufferReaderT(const uint8_t *annexb_buffer, size_t length)
+      : start_(annexb_buffer), length_(length)
+  {
+    offsets_ = H264::FindNaluIndices(annexb_buffer, length);
+    offset_ = offsets_.begin();
+  }
+  AnnexBBufferReaderT(const AnnexBBufferReaderT &other) = delete;
+  void operator=(const AnnexBBufferReaderT &other) = delete;
+
+  // Returns a pointer to the beginning of the next NALU slice without the
+  // header bytes and its length. Returns false if no more slices remain.
+  bool ReadNalu(const uint8_t **out_nalu, size_t *out_length)
+  {
+    *out_nalu = nullptr;
+    *out_length = 0;
+
+    if (offset_ == offsets_.end())
+    {
+      return false;
+    }
+    *out_nalu = start_ + offset_->payload_start_offset;
+    *out_length = offset_->payload_size;
+    ++offset_;
+    return true;
+  }
+
+  // Returns the number of unread NALU bytes, including the size of the header.
+  // If the buffer has no remaining NALUs this will return zero.
+  size_t BytesRemaining() const
+  {
+    if (offset_ == offsets_.end())
+    {
+      return 0;
+    }
+    return length_ - offset_->start_offset;
+  }
+
+  // Returns the size the unread NALUs take up in avcc format. Differs from
+  // BytesRemaining() when the buffer uses 3 byte start codes.
+  size_t AvccBytesRemaining() const
+  {
+    size_t size = 0;
+    for (auto it = offset_; it != offsets_.end(); ++it)
+    {
+      size += kAvccHeaderByteSize + it->payload_size;
+    }
+    return size;
+  }
+
+  // Reset the reader to start reading from the first NALU
+  void SeekToStart() { offset_ = offsets_.begin(); }
+
+  // Seek to the next position that holds a NALU of the desired type,
+  // or the end if no such NALU is found.
+  // Return true if a NALU of the desired type is found, false if we
+  // reached the end instead
+  bool SeekToNextNaluOfType(NaluType type)
+  {
+    for (; offset_ != offsets_.end(); ++offset_)
+    {
+      if (offset_->payload_size < Traits::kNaluHeaderSize)
+        continue;
+      if (Traits::ParseNaluType(start_ + offset_->payload_start_offset) ==
+          type)
+        return true;
+    }
+    return false;
+  }
+
+private:
+  const uint8_t *const start_;
+  std::vector<NaluIndex> offsets_;
+  typename std::vector<NaluIndex>::iterator offset_;
+  const size_t length_;
+};
+
+typedef AnnexBBufferReaderT<H264Traits> AnnexBBufferReader;
+typedef AnnexBBufferReaderT<H265Traits> H265AnnexBBufferReader;
+
+// Helper class for writing NALUs using avcc format into a buffer.
+class AvccBufferWriter final
+{
+public:
+  AvccBufferWriter(uint8_t *const avcc_buffer, size_t length)
+      : start_(avcc_buffer), offset_(0), length_(length) {}
+  ~AvccBufferWriter() {}
+  AvccBufferWriter(const AvccBufferWriter &other) = delete;
+  void operator=(const AvccBufferWriter &other) = delete;
+
+  // Writes the data slice into the buffer. Returns false if there isn't
+  // enough space left.
+  bool WriteNalu(const uint8_t *data, size_t data_size)
+  {
+    // Check if we can write this length of data.
+    if (data_size + kAvccHeaderByteSize > BytesRemaining())
+    {
+      return false;
+    }
+    // Write length header, which needs to be big endian.
+    uint8_t *header = start_ + offset_;
+    header[0] = static_cast<uint8_t>(data_size >> 24);
+    header[1] = static_cast<uint8_t>(data_size >> 16);
+    header[2] = static_cast<uint8_t>(data_size >> 8);
+    header[3] = static_cast<uint8_t>(data_size);
+    offset_ += kAvccHeaderByteSize;
+    // Write data.
+    memcpy(start_ + offset_, data, data_size);
+    offset_ += data_size;
+    return true;
+  }
+
+  // Returns the unused bytes in the buffer.
+  size_t BytesRemaining() const { return length_ - offset_; }
+
+private:
+  uint8_t *const start_;
+  size_t offset_;
+  const size_t length_;
+};
+
+// Moves |reader| past the parameter sets at the start of a keyframe, which
+// the decoder gets from the format description instead, or back to the first
+// NALU if the buffer has none. Returns false if they are truncated.
+template <typename Traits>
+bool SkipParameterSets(AnnexBBufferReaderT<Traits> &reader)
+{
+  if (!reader.SeekToNextNaluOfType(Traits::kFirstParameterSet))
+  {
+    reader.SeekToStart();
+    return true;
+  }
+  for (size_t i = 0; i < Traits::kParameterSetCount; ++i)
+  {
+    const uint8_t *data;
+    size_t data_len;
+    if (!reader.ReadNalu(&data, &data_len))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes the NALUs remaining in |reader| into |writer| in avcc format.
+template <typename Traits>
+bool WriteAvccNalus(AnnexBBufferReaderT<Traits> &reader,
+                    AvccBufferWriter &writer)
+{
+  const uint8_t *data = nullptr;
+  size_t data_size = 0;
+  while (reader.ReadNalu(&data, &data_size))
+  {
+    if (!writer.WriteNalu(data, data_size))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Finds the parameter sets needed to configure a decoder in |nalus|, in the
+// order of Traits::ParameterSetIndex (SPS, PPS for H264; VPS, SPS, PPS for
+// H265). The first occurrence of each type wins. Returns false unless all of
+// them are present.
+template <typename Traits>
+bool FindParameterSets(const uint8_t *buffer,
+                       const std::vector<NaluIndex> &nalus,
+                       const uint8_t **param_set_ptrs,
+                       size_t *param_set_sizes)
+{
+  size_t found = 0;
+  for (size_t i = 0; i < Traits::kParameterSetCount; ++i)
+  {
+    param_set_ptrs[i] = nullptr;
+    param_set_sizes[i] = 0;
+  }
+  for (const NaluIndex &nalu : nalus)
+  {
+    if (nalu.payload_size < Traits::kNaluHeaderSize)
+      continue;
+    const uint8_t *data = buffer + nalu.payload_start_offset;
+    const int index = Traits::ParameterSetIndex(Traits::ParseNaluType(data));
+    if (index < 0 || param_set_ptrs[index])
+      continue;
+    param_set_ptrs[index] = data;
+    param_set_sizes[index] = nalu.payload_size;
+    if (++found == Traits::kParameterSetCount)
+      return true;
+  }
+  return false;
+}
+
+struct AccessUnitIndex
+{
+  // Start index of the first NALU of the access unit, including start code.
+  size_t start_offset;
+  // Size of the access unit in bytes, counting from start_offset.
+  size_t size;
+  // Position of its first NALU in the NaluIndex vector, and NALU count.
+  size_t first_nalu;
+  size_t nalu_count;
+};
+
+// Splits a raw Annex B stream into access units, following the first-slice
+// flag of VCL NALUs and the non-VCL NALUs that may only open an access unit.
+// NALUs before the first access unit boundary form the first access unit.
+template <typename Traits>
+std::vector<AccessUnitIndex> FindAccessUnits(
+    const uint8_t *buffer, size_t buffer_size,
+    const std::vector<NaluIndex> &nalus)
+{
+  std::vector<AccessUnitIndex> access_units;
+  bool seen_vcl = false;
+  for (size_t i = 0; i < nalus.size(); ++i)
+  {
+    const NaluIndex &nalu = nalus[i];
+    bool boundary = access_units.empty();
+    bool vcl = false;
+    if (nalu.payload_size >= Traits::kNaluHeaderSize)
+    {
+      const uint8_t *data = buffer + nalu.payload_start_offset;
+      const typename Traits::NaluType type = Traits::ParseNaluType(data);
+      vcl = Traits::IsVcl(type);
+      if (seen_vcl)
+      {
+        boundary = vcl ? Traits::IsFirstSliceInPicture(data, nalu.payload_size)
+                       : Traits::StartsAccessUnit(type);
+      }
+    }
+
+    if (boundary)
+    {
+      if (!access_units.empty())
+      {
+        AccessUnitIndex &last = access_units.back();
+        last.size = nalu.start_offset - last.start_offset;
+      }
+      access_units.push_back({nalu.start_offset, 0, i, 0});
+      seen_vcl = false;
+    }
+    ++access_units.back().nalu_count;
+    seen_vcl |= vcl;
+  }
+
+  if (!access_units.empty())
+  {
+    AccessUnitIndex &last = access_units.back();
+    last.size = buffer_size - last.start_offset;
+  }
+  return access_units;
+}
+
+} // namespace webrtc
+
+#endif // ANNEXB_H_
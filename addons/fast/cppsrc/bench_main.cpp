@@ -0,0 +1,77 @@
+// Headless end-to-end throughput benchmark. Loops a frames directory through
+// the player's frame pipeline without pacing and prints the results as JSON,
+// so regressions can be tracked per commit on any machine.
+//
+//   player_bench <frames dir> [--loops N] [--warmup FRAMES]
+//                [--codec h264|h265]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "benchmark.h"
+#include "frame_loader.h"
+
+using namespace fast;
+
+namespace {
+int usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s <frames dir> [--loops N] [--warmup FRAMES] "
+          "[--codec h264|h265]\n",
+          program);
+  return 2;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    return usage(argv[0]);
+  }
+
+  BenchmarkOptions options;
+  std::string codec = "h264";
+  for (int i = 2; i < argc; i += 2) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Missing value for %s\n", argv[i]);
+      return usage(argv[0]);
+    }
+    if (arg == "--loops") {
+      options.loops = atoi(argv[i + 1]);
+    } else if (arg == "--warmup") {
+      options.warmupFrames = atoi(argv[i + 1]);
+    } else if (arg == "--codec") {
+      codec = argv[i + 1];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return usage(argv[0]);
+    }
+  }
+  if (options.loops < 1 || options.warmupFrames < 0 ||
+      (codec != "h264" && codec != "h265")) {
+    return usage(argv[0]);
+  }
+
+  std::vector<FrameEntry> frames = loadFrames(argv[1], codec);
+  if (frames.empty()) {
+    fprintf(stderr, "No frames found in %s\n", argv[1]);
+    return 1;
+  }
+
+  try {
+    if (codec == "h265") {
+      H265HeadlessDecoder decoder;
+      printf("%s\n", runBenchmark(frames, decoder, options).c_str());
+    } else {
+      HeadlessDecoder decoder;
+      printf("%s\n", runBenchmark(frames, decoder, options).c_str());
+    }
+  } catch (const std::exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include "benchmark.h"
+
+#include <string.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+using namespace fast;
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMilliseconds(Clock::time_point start, Clock::time_point end) {
+  return 1.0e-6 *
+         std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+             .count();
+}
+
+double cpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         1.0e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+uint64_t peakRssBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  // Linux reports kilobytes.
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void writeStage(std::ostringstream &out, const char *name,
+                std::vector<double> &samples) {
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double p) {
+    if (samples.empty()) {
+      return 0.0;
+    }
+    return samples[std::min(samples.size() - 1,
+                            static_cast<size_t>(p * samples.size()))];
+  };
+  double sum = 0;
+  for (double sample : samples) {
+    sum += sample;
+  }
+
+  out << "\"" << name << "\": {\"mean\": "
+      << (samples.empty() ? 0 : sum / samples.size())
+      << ", \"p50\": " << at(0.5) << ", \"p90\": " << at(0.9)
+      << ", \"p99\": " << at(0.99) << ", \"max\": " << at(1.0) << "}";
+}
+} // namespace
+
+std::string fast::runBenchmark(const std::vector<FrameEntry> &frames,
+                               BenchmarkDecoder &decoder,
+                               const BenchmarkOptions &options) {
+  if (options.loops < 1 || options.warmupFrames < 0) {
+    throw std::runtime_error("Benchmark needs loops >= 1 and warmup >= 0");
+  }
+
+  // The player skips empty AU files without decoding, so they are left out
+  // rather than counted as frames.
+  std::vector<const FrameEntry *> nonEmpty;
+  size_t largest = 0;
+  for (const auto &frame : frames) {
+    if (!frame.data.empty()) {
+      nonEmpty.push_back(&frame);
+      largest = std::max(largest, frame.data.size());
+    }
+  }
+  // Decoders rewrite start codes in place, so every AU is copied into this
+  // buffer first, like a receiver handing over a freshly reassembled frame.
+  std::vector<uint8_t> scratch(largest);
+
+  const size_t total = nonEmpty.size() * options.loops;
+  std::vector<double> copyTimes, decodeTimes, frameTimes;
+  copyTimes.reserve(total);
+  decodeTimes.reserve(total);
+  frameTimes.reserve(total);
+
+  size_t decoded = 0;
+  size_t measured = 0;
+  size_t failures = 0;
+  uint64_t bytes = 0;
+  double frameSeconds = 0;
+  double cpuStart = 0;
+  Clock::time_point measureStart;
+  for (int loop = 0; loop < options.loops; ++loop) {
+    for (const FrameEntry *entry : nonEmpty) {
+      const FrameEntry &frame = *entry;
+      const bool warm = decoded >= static_cast<size_t>(options.warmupFrames);
+      if (warm && measured == 0) {
+        cpuStart = cpuSeconds();
+        measureStart = Clock::now();
+      }
+
+      const Clock::time_point start = Clock::now();
+      memcpy(scratch.data(), frame.data.data(), frame.data.size());
+      const Clock::time_point copied = Clock::now();
+      if (!decoder.decode(scratch.data(), frame.data.size())) {
+        ++failures;
+      }
+      const Clock::time_point end = Clock::now();
+      ++decoded;
+
+      if (!warm) {
+        continue;
+      }
+      copyTimes.push_back(elapsedMilliseconds(start, copied));
+      decodeTimes.push_back(elapsedMilliseconds(copied, end));
+      frameTimes.push_back(elapsedMilliseconds(start, end));
+      frameSeconds += 1.0e-3 * frameTimes.back();
+      bytes += frame.data.size();
+      ++measured;
+    }
+  }
+  if (measured == 0) {
+    throw std::runtime_error("No frames left to measure after the warmup");
+  }
+  // Wall-clock time of the measured frames, including anything between them
+  // that the per-frame times miss.
+  const double seconds =
+      1.0e-3 * elapsedMilliseconds(measureStart, Clock::now());
+  const double cpu = cpuSeconds() - cpuStart;
+
+  std::ostringstream out;
+  out << "{\"frames\": " << measured << ", \"warmup_frames\": "
+      << decoded - measured << ", \"empty_frames_skipped\": "
+      << (frames.size() - nonEmpty.size()) * options.loops
+      << ", \"loops\": " << options.loops
+      << ", \"failures\": " << failures
+      << ", \"seconds\": " << seconds << ", \"frame_seconds\": "
+      << frameSeconds << ", \"frames_per_second\": "
+      << (seconds > 0 ? measured / seconds : 0) << ", \"mb_per_second\": "
+      << (seconds > 0 ? bytes / seconds / (1024 * 1024) : 0)
+      << ", \"stages_ms\": {";
+  writeStage(out, "copy", copyTimes);
+  out << ", ";
+  writeStage(out, "decode", decodeTimes);
+  out << ", ";
+  writeStage(out, "frame", frameTimes);
+  out << "}, \"cpu_seconds\": " << cpu
+      << ", \"peak_rss_bytes\": " << peakRssBytes() << "}";
+  return out.str();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "annexb.h"
+#include "frame_loader.h"
+
+namespace fast {
+struct BenchmarkOptions {
+  // Passes over the input. Each pass feeds the first AU again, without
+  // restarting the decoder.
+  int loops = 10;
+  // Decoded AUs discarded before measuring, to get past session creation and
+  // cold caches.
+  int warmupFrames = 60;
+};
+
+// The decoder stage driven by the benchmark.
+class BenchmarkDecoder {
+public:
+  virtual ~BenchmarkDecoder() {}
+
+  // Decodes one AU in place.
+  virtual bool decode(uint8_t *frame, size_t size) = 0;
+};
+
+// Does the Annex B to AVCC conversion the VideoToolbox path performs before
+// handing a frame to the hardware, but no actual decode. Lets the benchmark
+// run on machines without VideoToolbox, e.g. Linux CI.
+template <typename Traits>
+class HeadlessDecoderT final : public BenchmarkDecoder {
+public:
+  bool decode(uint8_t *frame, size_t size) override {
+    // Same as DecodeRender, which skips empty AUs.
+    if (size == 0) {
+      return true;
+    }
+
+    webrtc::AnnexBBufferReaderT<Traits> reader(frame, size);
+    if (!webrtc::SkipParameterSets(reader)) {
+      return false;
+    }
+    m_avcc.resize(reader.AvccBytesRemaining());
+    webrtc::AvccBufferWriter writer(m_avcc.data(), m_avcc.size());
+    return webrtc::WriteAvccNalus(reader, writer);
+  }
+
+private:
+  std::vector<uint8_t> m_avcc;
+};
+
+typedef HeadlessDecoderT<webrtc::H264Traits> HeadlessDecoder;
+typedef HeadlessDecoderT<webrtc::H265Traits> H265HeadlessDecoder;
+
+// Feeds |frames| to |decoder| as fast as possible and returns the results as
+// JSON: wall-clock and summed per-frame time, frames/s and MB/s over the
+// wall-clock time, per-stage latency percentiles in milliseconds, CPU time and
+// peak RSS. Empty AUs are skipped. Throws std::runtime_error for negative
+// options or if the warmup leaves no frame to measure.
+std::string runBenchmark(const std::vector<FrameEntry> &frames,
+                         BenchmarkDecoder &decoder,
+                         const BenchmarkOptions &options);
+} // namespace fast
@@ -0,0 +1,108 @@
+#ifndef CODEC_TRAITS_H_
+#define CODEC_TRAITS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "h264_common.h"
+#include "h265_common.h"
+
+namespace webrtc
+{
+
+// Per-codec knowledge needed by the Annex B templates in annexb.h. Everything
+// is static and inline, so the H264 and H265 instantiations compile down to
+// plain comparisons with no dispatch inside the NALU loops.
+//
+// Each traits type provides:
+//   NaluType                 the codec's NALU type enum
+//   kNaluHeaderSize          bytes of NALU header before the payload
+//   kParameterSetCount       parameter sets needed to configure a decoder
+//   kFirstParameterSet       type of the first of them; the others follow it
+//   ParseNaluType(nalu)      type of the NALU starting at |nalu|
+//   ParameterSetIndex(type)  position of |type| in the parameter set list
+//                            (VPS, SPS, PPS order), or -1
+//   IsVcl(type)              whether the NALU carries slice data
+//   IsKeyframe(type)         whether a VCL NALU starts a random access point
+//   StartsAccessUnit(type)   whether a non-VCL NALU of this type following a
+//                            VCL NALU opens the next access unit
+//   IsFirstSliceInPicture(nalu, size)
+//                            whether a VCL NALU is the first slice of a
+//                            picture
+struct H264Traits
+{
+  typedef H264::NaluType NaluType;
+
+  static const size_t kNaluHeaderSize = H264::kNaluTypeSize;
+  static const size_t kParameterSetCount = 2;
+  static const NaluType kFirstParameterSet = H264::kSps;
+
+  static NaluType ParseNaluType(const uint8_t *nalu)
+  {
+    return H264::ParseNaluType(nalu[0]);
+  }
+
+  static int ParameterSetIndex(NaluType type)
+  {
+    return type == H264::kSps ? 0 : type == H264::kPps ? 1 : -1;
+  }
+
+  static bool IsVcl(NaluType type) { return type >= 1 && type <= 5; }
+
+  static bool IsKeyframe(NaluType type) { return type == H264::kIdr; }
+
+  // See section 7.4.1.2.3 of the H264 spec.
+  static bool StartsAccessUnit(NaluType type)
+  {
+    return type == H264::kAud || type == H264::kSps || type == H264::kPps ||
+           type == H264::kSei || (type >= 14 && type <= 18);
+  }
+
+  // first_mb_in_slice is ue(v) coded right after the header, and is zero
+  // exactly when its first bit is set.
+  static bool IsFirstSliceInPicture(const uint8_t *nalu, size_t size)
+  {
+    return size > kNaluHeaderSize && (nalu[kNaluHeaderSize] & 0x80);
+  }
+};
+
+struct H265Traits
+{
+  typedef H265::NaluType NaluType;
+
+  static const size_t kNaluHeaderSize = H265::kNaluHeaderSize;
+  static const size_t kParameterSetCount = 3;
+  static const NaluType kFirstParameterSet = H265::kVps;
+
+  static NaluType ParseNaluType(const uint8_t *nalu)
+  {
+    return H265::ParseNaluType(nalu[0]);
+  }
+
+  static int ParameterSetIndex(NaluType type)
+  {
+    return type >= H265::kVps && type <= H265::kPps ? type - H265::kVps : -1;
+  }
+
+  static bool IsVcl(NaluType type) { return H265::IsVcl(type); }
+
+  static bool IsKeyframe(NaluType type) { return H265::IsIrap(type); }
+
+  // See section 7.4.2.4.4 of the H265 spec.
+  static bool StartsAccessUnit(NaluType type)
+  {
+    return (type >= H265::kVps && type <= H265::kAud) ||
+           type == H265::kPrefixSei || (type >= 41 && type <= 44) ||
+           (type >= 48 && type <= 55);
+  }
+
+  // first_slice_segment_in_pic_flag is the first bit after the header.
+  static bool IsFirstSliceInPicture(const uint8_t *nalu, size_t size)
+  {
+    return size > kNaluHeaderSize && (nalu[kNaluHeaderSize] & 0x80);
+  }
+};
+
+} // namespace webrtc
+
+#endif // CODEC_TRAITS_H_
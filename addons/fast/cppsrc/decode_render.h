@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "picture_pool.h"
+
 namespace fast {
 struct FrameStatistics {
   int index;
@@ -38,6 +40,9 @@ public:
   DecodeRender();
   ~DecodeRender();
   bool decode_render(std::vector<uint8_t> &frame);
+  // Decodes an access unit in place. |frame| must stay writable, as the
+  // single NALU path rewrites the start code into an AVCC length header.
+  bool decode_render(uint8_t *frame, size_t size);
   void decode_render_local(std::vector<uint8_t> &frame, bool multiple_nalu);
   void reset();
   int get_width();
@@ -45,6 +50,14 @@ public:
   void setConnectionErrorVisible(bool visible);
   std::vector<FrameStatistics> getFrameStatistics() const;
 
+  // The most recently decoded picture, shared with the caller. Empty until the
+  // first frame has been decoded.
+  PictureRef latestPicture();
+  // Copies the decoder output of |picture| into |nv12|, resized to fit, for
+  // screenshot style consumers. Safe to call from several consumers at once.
+  bool readback(const DecodedPicture &picture, std::vector<uint8_t> &nv12);
+  PicturePoolStatistics getPoolStatistics() const;
+
 private:
   struct Context;
   Context *m_context = nullptr;
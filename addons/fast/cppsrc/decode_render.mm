@@ -1,6 +1,8 @@
 #include "decode_render.h"
 
+#include <algorithm>
 #include <exception>
+#include <mutex>
 
 #include <SDL2/SDL_syswm.h>
 
@@ -14,6 +16,22 @@
 
 using namespace fast;
 
+// The latest picture plus one for each consumer holding on to a frame:
+// present, damage tracking and screenshots.
+const size_t kPicturePoolSize = 4;
+// How long the decoder waits for consumers to return a picture before the
+// frame is dropped.
+const int64_t kPictureWaitMilliseconds = 100;
+
+// Whether |frame| opens with an SPS, as keyframes that repeat the parameter
+// sets do. Those need the multiple NALU path, which skips them.
+static bool startsWithParameterSets(const uint8_t *frame, size_t size) {
+  // 3 or 4 byte start code.
+  const size_t header = size > 3 && frame[2] == 1 ? 3 : 4;
+  return size > header &&
+         webrtc::H264::ParseNaluType(frame[header]) == webrtc::H264::kSps;
+}
+
 PlayerStatistics::PlayerStatistics() : m_index(0), m_currentFrame({0, 0, 0}) {}
 
 void PlayerStatistics::startFrame() { m_currentFrame = {m_index++, 0, 0}; }
@@ -50,10 +68,15 @@ struct DecodeRender::Context {
   CMVideoFormatDescriptionRef formatDescription;
   CMVideoDimensions videoDimensions;
   PlayerStatistics statistics;
+  std::shared_ptr<PicturePool> pictures;
+  std::mutex latestMutex;
+  PictureRef latest;
+  uint64_t decodedPictures = 0;
 
   Context()
       : semaphore(NULL), memoryPool(NULL), decompressionSession(NULL),
-        formatDescription(NULL) {
+        formatDescription(NULL),
+        pictures(PicturePool::create(kPicturePoolSize)) {
     semaphore = dispatch_semaphore_create(1);
     memoryPool = CMMemoryPoolCreate(NULL);
   }
@@ -78,8 +101,12 @@ struct DecodeRender::Context {
     }
   }
 
-  void setup(std::vector<uint8_t> &frame);
-  CMSampleBufferRef create(std::vector<uint8_t> &frame, bool multiple_nalu);
+  void setup(uint8_t *frame, size_t size);
+  // Whether the parameter sets in |frame| differ from formatDescription.
+  bool formatChanged(uint8_t *frame, size_t size);
+  // Releases the session and format description, for setup() to start over.
+  void destroySession();
+  CMSampleBufferRef create(uint8_t *frame, size_t size, bool multiple_nalu);
 
   static void didDecompress(void *decompressionOutputRefCon,
                             void *sourceFrameRefCon, OSStatus status,
@@ -104,13 +131,27 @@ DecodeRender::~DecodeRender() {
 }
 
 bool DecodeRender::decode_render(std::vector<uint8_t> &frame) {
-  if (frame.size() == 0) {
+  return decode_render(frame.data(), frame.size());
+}
+
+bool DecodeRender::decode_render(uint8_t *frame, size_t size) {
+  if (size == 0) {
     return true;
   }
 
-  bool multiple_nalu = first_frame;
+  const bool parameter_sets = startsWithParameterSets(frame, size);
+  // A keyframe with new parameter sets, e.g. after a resolution change,
+  // starts over with a new session, like the first frame.
+  if (!first_frame && parameter_sets &&
+      m_context->formatChanged(frame, size)) {
+    NSLog(@"Parameter sets changed, recreating the decompression session");
+    m_context->destroySession();
+    first_frame = true;
+  }
+
+  bool multiple_nalu = first_frame || parameter_sets;
   if (first_frame) {
-    m_context->setup(frame);
+    m_context->setup(frame, size);
     first_frame = false;
   }
 
@@ -122,7 +163,8 @@ bool DecodeRender::decode_render(std::vector<uint8_t> &frame) {
     return false;
   }
 
-  CMSampleBufferRef sampleBuffer = m_context->create(frame, multiple_nalu);
+  CMSampleBufferRef sampleBuffer =
+      m_context->create(frame, size, multiple_nalu);
   if (sampleBuffer == NULL) {
     NSLog(@"sampleBuffer is NULL");
     dispatch_semaphore_signal(m_context->semaphore);
@@ -163,18 +205,8 @@ void DecodeRender::reset() {
   NSLog(@"Resetting. Waiting for semaphore");
   dispatch_semaphore_wait(m_context->semaphore, DISPATCH_TIME_FOREVER);
 
-  if (m_context->decompressionSession) {
-    NSLog(@"Resetting. Invalidate session");
-    VTDecompressionSessionInvalidate(m_context->decompressionSession);
-    CFRelease(m_context->decompressionSession);
-    m_context->decompressionSession = NULL;
-  }
-
-  if (m_context->formatDescription) {
-    CFRelease(m_context->formatDescription);
-    m_context->formatDescription = NULL;
-  }
-
+  NSLog(@"Resetting. Invalidate session");
+  m_context->destroySession();
   first_frame = true;
 
   NSLog(@"Resetting. Signal semaphore");
@@ -182,15 +214,85 @@ void DecodeRender::reset() {
   NSLog(@"Resetting. Done");
 }
 
+PictureRef DecodeRender::latestPicture() {
+  std::lock_guard<std::mutex> lock(m_context->latestMutex);
+  return m_context->latest;
+}
+
+bool DecodeRender::readback(const DecodedPicture &picture,
+                            std::vector<uint8_t> &nv12) {
+  CVPixelBufferRef buffer = (CVPixelBufferRef)picture.native();
+  if (buffer == NULL || CVPixelBufferGetPlaneCount(buffer) != 2) {
+    return false;
+  }
+  if (CVPixelBufferLockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly) !=
+      kCVReturnSuccess) {
+    return false;
+  }
+
+  // Luma rows are |width| bytes, interleaved chroma rows cover the same width
+  // at half the height.
+  const size_t widths[2] = {(size_t)picture.width(),
+                            2 * (size_t)((picture.width() + 1) / 2)};
+  const size_t heights[2] = {(size_t)picture.height(),
+                             (size_t)((picture.height() + 1) / 2)};
+  nv12.resize(widths[0] * heights[0] + widths[1] * heights[1]);
+  uint8_t *out = nv12.data();
+  for (size_t plane = 0; plane < 2; ++plane) {
+    const uint8_t *in =
+        (const uint8_t *)CVPixelBufferGetBaseAddressOfPlane(buffer, plane);
+    const size_t stride = CVPixelBufferGetBytesPerRowOfPlane(buffer, plane);
+    const size_t width = std::min(widths[plane], stride);
+    const size_t rows = std::min(
+        heights[plane], CVPixelBufferGetHeightOfPlane(buffer, plane));
+    for (size_t row = 0; row < rows; ++row) {
+      memcpy(out + row * widths[plane], in + row * stride, width);
+    }
+    out += widths[plane] * heights[plane];
+  }
+
+  CVPixelBufferUnlockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly);
+  return true;
+}
+
+PicturePoolStatistics DecodeRender::getPoolStatistics() const {
+  return m_context->pictures->getStatistics();
+}
+
 int DecodeRender::get_width() { return m_context->videoDimensions.width; }
 
 int DecodeRender::get_height() { return m_context->videoDimensions.height; }
 
 void DecodeRender::setConnectionErrorVisible(bool visible) {}
 
-void DecodeRender::Context::setup(std::vector<uint8_t> &frame) {
-  formatDescription =
-      webrtc::CreateVideoFormatDescription(frame.data(), frame.size());
+bool DecodeRender::Context::formatChanged(uint8_t *frame, size_t size) {
+  CMVideoFormatDescriptionRef format =
+      webrtc::CreateVideoFormatDescription(frame, size);
+  if (format == NULL) {
+    // Keep decoding with the current format.
+    return false;
+  }
+  const bool changed = formatDescription == NULL ||
+                       !CMFormatDescriptionEqual(format, formatDescription);
+  CFRelease(format);
+  return changed;
+}
+
+void DecodeRender::Context::destroySession() {
+  if (decompressionSession) {
+    VTDecompressionSessionInvalidate(decompressionSession);
+    CFRelease(decompressionSession);
+    decompressionSession = NULL;
+  }
+
+  if (formatDescription) {
+    CFRelease(formatDescription);
+    formatDescription = NULL;
+  }
+}
+
+void DecodeRender::Context::setup(uint8_t *frame, size_t size) {
+  formatDescription = webrtc::CreateVideoFormatDescription(frame, size);
   if (formatDescription == NULL) {
     throw std::runtime_error("webrtc::CreateVideoFormatDescription");
   }
@@ -200,6 +302,9 @@ void DecodeRender::Context::setup(std::vector<uint8_t> &frame) {
   printf("Setup decompression with video width: %d, height: %d\n",
          videoDimensions.width, videoDimensions.height);
 
+  // No-op unless the resolution changed since the last setup.
+  pictures->configure(videoDimensions.width, videoDimensions.height);
+
   NSDictionary *decoderSpecification = @{
     (NSString *)
     kVTVideoDecoderSpecification_RequireHardwareAcceleratedVideoDecoder : @(YES)
@@ -212,42 +317,36 @@ void DecodeRender::Context::setup(std::vector<uint8_t> &frame) {
     (NSString *)kCVPixelBufferIOSurfacePropertiesKey : @{}
   };
 
-  while (true) {
-    VTDecompressionOutputCallbackRecord callBackRecord;
-    callBackRecord.decompressionOutputCallback = didDecompress;
-    callBackRecord.decompressionOutputRefCon = this;
-    decompressionSession = NULL;
-    OSStatus session_ret = VTDecompressionSessionCreate(
-        kCFAllocatorDefault, formatDescription,
-        (__bridge CFDictionaryRef)decoderSpecification,
-        (__bridge CFDictionaryRef)attributes, &callBackRecord,
-        &decompressionSession);
-    if (session_ret != 0) {
-      NSLog(@"Failure. Error code: %d", session_ret);
-    } else {
-      NSLog(@"Successfully created the encoder");
-    }
-    usleep(100000);
-    if (decompressionSession) {
-      VTDecompressionSessionInvalidate(decompressionSession);
-      CFRelease(decompressionSession);
-    }
-    usleep(100000);
+  VTDecompressionOutputCallbackRecord callBackRecord;
+  callBackRecord.decompressionOutputCallback = didDecompress;
+  callBackRecord.decompressionOutputRefCon = this;
+  decompressionSession = NULL;
+  OSStatus session_ret = VTDecompressionSessionCreate(
+      kCFAllocatorDefault, formatDescription,
+      (__bridge CFDictionaryRef)decoderSpecification,
+      (__bridge CFDictionaryRef)attributes, &callBackRecord,
+      &decompressionSession);
+  if (session_ret != 0) {
+    NSLog(@"Failure. Error code: %d", session_ret);
+    // The next frame runs setup() again from scratch.
+    CFRelease(formatDescription);
+    formatDescription = NULL;
+    throw std::runtime_error("VTDecompressionSessionCreate");
   }
+  NSLog(@"Successfully created the decoder");
 }
 
-CMSampleBufferRef DecodeRender::Context::create(std::vector<uint8_t> &frame,
+CMSampleBufferRef DecodeRender::Context::create(uint8_t *frame, size_t size,
                                                 bool multiple_nalu) {
   CMSampleBufferRef sampleBuffer = NULL;
   if (multiple_nalu) {
-    if (!webrtc::H264AnnexBBufferToCMSampleBuffer(frame.data(), frame.size(),
-                                                  formatDescription,
-                                                  &sampleBuffer, memoryPool)) {
+    if (!webrtc::H264AnnexBBufferToCMSampleBuffer(
+            frame, size, formatDescription, &sampleBuffer, memoryPool)) {
       printf("ERROR: webrtc::H264AnnexBBufferToCMSampleBuffer\n");
     }
   } else {
     if (!webrtc::H264AnnexBBufferToCMSampleBufferSingleNALU(
-            frame.data(), frame.size(), formatDescription, &sampleBuffer)) {
+            frame, size, formatDescription, &sampleBuffer)) {
       printf("ERROR: webrtc::H264AnnexBBufferToCMSampleBuffer\n");
     }
   }
@@ -269,6 +368,21 @@ void DecodeRender::Context::didDecompress(
     NSLog(@"Error decompressing frame at time: %.3f error: %d infoFlags: %u",
           (float)presentationTimeStamp.value / presentationTimeStamp.timescale,
           (int)status, (unsigned int)infoFlags);
+  } else if (imageBuffer) {
+    // Blocks while consumers hold every picture, which holds up
+    // decode_render() and so the frame feed.
+    PictureRef picture =
+        context->pictures->acquire(kPictureWaitMilliseconds);
+    if (picture) {
+      picture->setNative(CVPixelBufferRetain(imageBuffer), [](void *buffer) {
+        CVPixelBufferRelease((CVPixelBufferRef)buffer);
+      });
+      picture->setSequence(context->decodedPictures++);
+      std::lock_guard<std::mutex> lock(context->latestMutex);
+      context->latest = std::move(picture);
+    } else {
+      NSLog(@"Picture pool exhausted, dropping frame");
+    }
   }
 
   dispatch_semaphore_signal(context->semaphore);
@@ -0,0 +1,57 @@
+#include "frame_loader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <regex>
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/types.h>
+
+std::vector<fast::FrameFile> fast::listFrames(const std::string &path,
+                                              const std::string &extension) {
+  DIR *dp = opendir(path.c_str());
+  if (dp == NULL) {
+    return {};
+  }
+
+  const std::regex pattern(".+_au_([0-9]+)\\." + extension);
+  std::vector<FrameFile> files;
+  while (struct dirent *ep = readdir(dp)) {
+    if (ep->d_type != DT_REG) {
+      continue;
+    }
+
+    std::string name(ep->d_name, strlen(ep->d_name));
+    std::smatch m;
+    if (std::regex_match(name, m, pattern)) {
+      files.push_back({std::stoi(m[1].str()), name});
+    }
+  }
+  closedir(dp);
+
+  std::sort(files.begin(), files.end(),
+            [](const FrameFile &a, const FrameFile &b) {
+              return a.index < b.index;
+            });
+  return files;
+}
+
+std::vector<fast::FrameEntry> fast::loadFrames(const std::string &path,
+                                               const std::string &extension) {
+  std::vector<FrameEntry> frames;
+  for (const FrameFile &entry : listFrames(path, extension)) {
+    std::ifstream file(path + "/" + entry.name,
+                       std::ios::binary | std::ios::ate);
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<uint8_t> buffer(size);
+    if (file.read((char *)buffer.data(), size)) {
+      frames.push_back({entry.index, entry.name, buffer});
+    }
+  }
+
+  return frames;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace fast {
+struct FrameEntry {
+  int index;
+  std::string name;
+  std::vector<uint8_t> data;
+};
+
+struct FrameFile {
+  int index;
+  std::string name;
+};
+
+// Lists the "*_au_<index>.<extension>" files in |path| without reading them,
+// sorted by index. Returns an empty vector if the directory can't be read.
+std::vector<FrameFile> listFrames(const std::string &path,
+                                  const std::string &extension = "h264");
+
+// Loads every "*_au_<index>.<extension>" file in |path|, one access unit per
+// file, sorted by index. |extension| is the codec name, "h264" or "h265".
+// Returns an empty vector if the directory can't be read.
+std::vector<FrameEntry> loadFrames(const std::string &path,
+                                   const std::string &extension = "h264");
+} // namespace fast
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace fast {
+// An access unit handed out by a FrameSource. The memory belongs to the source
+// and is writable, so the decoder can rewrite start codes in place.
+struct FrameView {
+  uint8_t *data;
+  size_t size;
+};
+
+// Where the player pulls access units from when they are not preloaded.
+class FrameSource {
+public:
+  virtual ~FrameSource() {}
+
+  // Blocks until the next access unit is available. The view stays valid until
+  // release() is called. Returns false once the stream has ended.
+  virtual bool next(FrameView &frame) = 0;
+
+  // Gives the access unit returned by the last next() back to the source.
+  virtual void release() = 0;
+};
+} // namespace fast
@@ -4,7 +4,9 @@
 #include <string>
 #include <vector>
 
+#include "benchmark.h"
 #include "decode_render.h"
+#include "frame_source.h"
 
 namespace fast {
 class MinimalPlayer {
@@ -15,6 +17,19 @@ class MinimalPlayer {
 
  public:
   void play(const std::string& path);
+  // Feeds a captured trace to the decoder with its recorded arrival timing,
+  // scaled by |speed| (0 feeds frames as fast as possible).
+  void replay(const std::string& trace_path, double speed = 1.0);
+  // Decodes access units from |source| as they arrive, until it ends.
+  void play_source(FrameSource &source);
+  // Decodes the frames in |path| back to back, with no pacing and no restarts,
+  // and returns the results as JSON. |headless| skips VideoToolbox and only
+  // runs the AVCC conversion.
+  std::string benchmark(const std::string& path,
+                        const BenchmarkOptions& options, bool headless);
   void handle_event(SDL_Event &event);
+
+ private:
+  static void write_statistics(const DecodeRender &decodeRender);
 };
 }  // namespace fast
@@ -1,60 +1,33 @@
 #include "h264_player.h"
 
-#include <fstream>
 #include <memory>
-#include <regex>
+#include <stdexcept>
 #include <vector>
 
-#include <dirent.h>
 #include <stdio.h>
-#include <sys/types.h>
 #include <unistd.h>
 
 #include "decode_render.h"
+#include "frame_loader.h"
 #include "timer.h"
+#include "trace.h"
 
 using namespace fast;
 
-struct FrameEntry {
-  int index;
-  std::string name;
-  std::vector<uint8_t> data;
-};
-
-std::vector<FrameEntry> load(const std::string &path) {
-  DIR *dp = opendir(path.c_str());
-  if (dp == NULL) {
-    return {};
-  }
-
-  const std::regex pattern(".+_au_([0-9]+)\\.h264");
-  std::vector<FrameEntry> frames;
-  while (struct dirent *ep = readdir(dp)) {
-    if (ep->d_type != DT_REG) {
-      continue;
-    }
-
-    std::string name(ep->d_name, ep->d_namlen);
-    std::smatch m;
-    if (std::regex_match(name, m, pattern)) {
-      std::ifstream file(path + "/" + name, std::ios::binary | std::ios::ate);
+namespace {
+class VideoToolboxDecoder final : public BenchmarkDecoder {
+public:
+  explicit VideoToolboxDecoder(DecodeRender &decodeRender)
+      : m_decodeRender(decodeRender) {}
 
-      std::streamsize size = file.tellg();
-      file.seekg(0, std::ios::beg);
-
-      std::vector<uint8_t> buffer(size);
-      if (file.read((char *)buffer.data(), size)) {
-        frames.push_back({std::stoi(m[1].str()), name, buffer});
-      }
-    }
+  bool decode(uint8_t *frame, size_t size) override {
+    return m_decodeRender.decode_render(frame, size);
   }
-  closedir(dp);
 
-  std::sort(frames.begin(), frames.end(),
-            [](const auto &a, const auto &b) { return a.index < b.index; });
-
-  return frames;
-}
+private:
+  DecodeRender &m_decodeRender;
+};
+} // namespace
 
 void MinimalPlayer::handle_event(SDL_Event &event) {
   switch (event.type) {
@@ -86,7 +59,7 @@ void MinimalPlayer::handle_event(SDL_Event &event) {
 
 void MinimalPlayer::play(const std::string &path) {
   Timer t;
-  std::vector<FrameEntry> frames = load(path);
+  std::vector<FrameEntry> frames = loadFrames(path);
   if (frames.empty()) {
     return;
   }
@@ -126,13 +99,79 @@ void MinimalPlayer::play(const std::string &path) {
       // }
     }
 
-    FILE *file = fopen("result.csv", "w");
-    if (file != NULL) {
-      fprintf(file, "frame,decoding,rendering\n");
-      for (const auto &e : decodeRender->getFrameStatistics()) {
-        fprintf(file, "%d,%f,%f\n", e.index, e.decodingTime, e.renderingTime);
-      }
-      fclose(file);
+    write_statistics(*decodeRender);
+  };
+}
+
+void MinimalPlayer::replay(const std::string &trace_path, double speed) {
+  std::vector<TraceFrame> frames = loadTrace(trace_path);
+  if (frames.empty()) {
+    return;
+  }
+
+  printf("Replaying %zu frames at %.2fx\n", frames.size(), speed);
+
+  @autoreleasepool {
+    decodeRender = std::make_unique<DecodeRender>();
+
+    VideoToolboxDecoder decoder(*decodeRender);
+    const ReplayResult result = replayTrace(frames, decoder, speed);
+    printf("Replay lateness: mean %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           result.meanLateness, result.p99Lateness, result.maxLateness);
+
+    write_statistics(*decodeRender);
+  };
+}
+
+void MinimalPlayer::play_source(FrameSource &source) {
+  @autoreleasepool {
+    decodeRender = std::make_unique<DecodeRender>();
+
+    FrameView frame;
+    while (source.next(frame)) {
+      decodeRender->decode_render(frame.data, frame.size);
+      source.release();
     }
+
+    write_statistics(*decodeRender);
   };
 }
+
+std::string MinimalPlayer::benchmark(const std::string &path,
+                                     const BenchmarkOptions &options,
+                                     bool headless) {
+  std::vector<FrameEntry> frames = loadFrames(path);
+  if (frames.empty()) {
+    throw std::runtime_error("No frames found in " + path);
+  }
+
+  if (headless) {
+    HeadlessDecoder decoder;
+    return runBenchmark(frames, decoder, options);
+  }
+
+  @autoreleasepool {
+    decodeRender = std::make_unique<DecodeRender>();
+    VideoToolboxDecoder decoder(*decodeRender);
+    return runBenchmark(frames, decoder, options);
+  };
+}
+
+void MinimalPlayer::write_statistics(const DecodeRender &decodeRender) {
+  FILE *file = fopen("result.csv", "w");
+  if (file != NULL) {
+    fprintf(file, "frame,decoding,rendering\n");
+    for (const auto &e : decodeRender.getFrameStatistics()) {
+      fprintf(file, "%d,%f,%f\n", e.index, e.decodingTime, e.renderingTime);
+    }
+    fclose(file);
+  }
+
+  const PicturePoolStatistics pool = decodeRender.getPoolStatistics();
+  printf("Picture pool: %zu/%zu in use (peak %zu), %llu pictures allocated, "
+         "%llu acquired, %llu waited, %llu dropped\n",
+         pool.inUse, pool.capacity, pool.peakInUse,
+         (unsigned long long)pool.pictureAllocations,
+         (unsigned long long)pool.acquisitions,
+         (unsigned long long)pool.waits, (unsigned long long)pool.timeouts);
+}
@@ -0,0 +1,26 @@
+/*
+ *  Copyright (c) 2016 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "h265_common.h"
+
+namespace webrtc
+{
+namespace H265
+{
+
+const uint8_t kNaluTypeMask = 0x7E;
+
+NaluType ParseNaluType(uint8_t data)
+{
+  return static_cast<NaluType>((data & kNaluTypeMask) >> 1);
+}
+
+} // namespace H265
+} // namespace webrtc
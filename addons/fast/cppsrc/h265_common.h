@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2016 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef COMMON_VIDEO_H265_H265_COMMON_H_
+#define COMMON_VIDEO_H265_H265_COMMON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "h264_common.h"
+
+namespace webrtc
+{
+
+namespace H265
+{
+// Annex B framing and emulation prevention are the same as in H.264, so the
+// start code scanner and RBSP parser are shared.
+using H264::FindNaluIndices;
+using H264::kNaluLongStartSequenceSize;
+using H264::kNaluShortStartSequenceSize;
+using H264::NaluIndex;
+using H264::ParseRbsp;
+
+// The size of the NALU header (2): forbidden_zero_bit, nal_unit_type,
+// nuh_layer_id and nuh_temporal_id_plus1.
+const size_t kNaluHeaderSize = 2;
+
+// See table 7-1 of the H265 spec.
+enum NaluType : uint8_t
+{
+  kTrailN = 0,
+  kTrailR = 1,
+  kTsaN = 2,
+  kTsaR = 3,
+  kStsaN = 4,
+  kStsaR = 5,
+  kRadlN = 6,
+  kRadlR = 7,
+  kRaslN = 8,
+  kRaslR = 9,
+  kBlaWLp = 16,
+  kBlaWRadl = 17,
+  kBlaNLp = 18,
+  kIdrWRadl = 19,
+  kIdrNLp = 20,
+  kCra = 21,
+  kVps = 32,
+  kSps = 33,
+  kPps = 34,
+  kAud = 35,
+  kEndOfSequence = 36,
+  kEndOfBitstream = 37,
+  kFiller = 38,
+  kPrefixSei = 39,
+  kSuffixSei = 40,
+  kAp = 48,
+  kFu = 49
+};
+
+// Get the NAL type from the first header byte following the start sequence.
+NaluType ParseNaluType(uint8_t data);
+
+// VCL NALUs carry slice data; everything from 32 up is parameter sets, SEI and
+// other non-VCL units.
+inline bool IsVcl(NaluType type) { return type < kVps; }
+
+// Intra random access point: BLA, IDR, CRA or one of the two reserved IRAP
+// types that follow them.
+inline bool IsIrap(NaluType type)
+{
+  return type >= kBlaWLp && type <= 23;
+}
+
+} // namespace H265
+} // namespace webrtc
+
+#endif // COMMON_VIDEO_H265_H265_COMMON_H_
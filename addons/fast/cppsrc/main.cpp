@@ -11,6 +11,7 @@
 #include <thread>
 
 #include "h264_player.h"
+#include "shm_ring.h"
 
 using namespace std;
 using namespace Napi;
@@ -18,6 +19,9 @@ using namespace Napi;
 namespace app
 {
 void StartClientWrapped(const CallbackInfo &info);
+void ReplayTraceWrapped(const CallbackInfo &info);
+void StartShmClientWrapped(const CallbackInfo &info);
+Napi::Value BenchmarkWrapped(const CallbackInfo &info);
 } // namespace app
 
 void app::StartClientWrapped(const CallbackInfo &info)
@@ -43,9 +47,109 @@ void app::StartClientWrapped(const CallbackInfo &info)
   }
 }
 
+void app::ReplayTraceWrapped(const CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  std::string filename = info[0].As<Napi::String>().ToString();
+  double speed = 1.0;
+  if (info.Length() > 1)
+  {
+    speed = info[1].As<Napi::Number>().DoubleValue();
+  }
+  fast::MinimalPlayer player;
+  try
+  {
+    player.replay(filename, speed);
+  }
+  catch (const std::exception &e)
+  {
+    Napi::TypeError::New(env, e.what()).ThrowAsJavaScriptException();
+  }
+}
+
+void app::StartShmClientWrapped(const CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  std::string name = info[0].As<Napi::String>().ToString();
+  fast::MinimalPlayer player;
+  try
+  {
+    fast::ShmFrameSource source(name);
+    player.play_source(source);
+  }
+  catch (const std::exception &e)
+  {
+    Napi::TypeError::New(env, e.what()).ThrowAsJavaScriptException();
+  }
+}
+
+Napi::Value app::BenchmarkWrapped(const CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1)
+  {
+    Napi::TypeError::New(env, "Wrong number of arguments")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string filename = info[0].As<Napi::String>().ToString();
+  fast::BenchmarkOptions options;
+  bool headless = false;
+  if (info.Length() > 1 && info[1].IsObject())
+  {
+    Napi::Object settings = info[1].As<Napi::Object>();
+    if (settings.Has("loops"))
+    {
+      options.loops = settings.Get("loops").As<Napi::Number>().Int32Value();
+    }
+    if (settings.Has("warmup"))
+    {
+      options.warmupFrames =
+          settings.Get("warmup").As<Napi::Number>().Int32Value();
+    }
+    if (settings.Has("headless"))
+    {
+      headless = settings.Get("headless").As<Napi::Boolean>().Value();
+    }
+  }
+
+  fast::MinimalPlayer player;
+  try
+  {
+    return Napi::String::New(env, player.benchmark(filename, options, headless));
+  }
+  catch (const std::exception &e)
+  {
+    Napi::TypeError::New(env, e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
 Object InitAll(Env env, Object exports)
 {
   exports.Set("start_client", Function::New(env, app::StartClientWrapped));
+  exports.Set("replay_trace", Function::New(env, app::ReplayTraceWrapped));
+  exports.Set("start_shm_client",
+              Function::New(env, app::StartShmClientWrapped));
+  exports.Set("benchmark", Function::New(env, app::BenchmarkWrapped));
   return exports;
 }
 
@@ -19,14 +19,6 @@ typedef signed char BOOL;
 namespace webrtc
 {
 
-using H264::kAud;
-using H264::kSps;
-using H264::NaluIndex;
-using H264::NaluType;
-using H264::ParseNaluType;
-
-const size_t kAvccHeaderByteSize = sizeof(uint32_t);
-
 bool H264AnnexBBufferToCMSampleBufferSingleNALU(
     uint8_t *annexb_buffer, size_t annexb_buffer_size,
     CMVideoFormatDescriptionRef video_format,
@@ -86,47 +78,54 @@ bool H264AnnexBBufferToCMSampleBufferSingleNALU(
   return true;
 }
 
-bool H264AnnexBBufferToCMSampleBuffer(const uint8_t *annexb_buffer,
-                                      size_t annexb_buffer_size,
-                                      CMVideoFormatDescriptionRef video_format,
-                                      CMSampleBufferRef *out_sample_buffer,
-                                      CMMemoryPoolRef memory_pool)
+namespace
+{
+
+OSStatus CreateFormatDescription(H264Traits, const uint8_t *const *param_sets,
+                                 const size_t *param_set_sizes,
+                                 CMVideoFormatDescriptionRef *description)
+{
+  return CMVideoFormatDescriptionCreateFromH264ParameterSets(
+      kCFAllocatorDefault, H264Traits::kParameterSetCount, param_sets,
+      param_set_sizes, kAvccHeaderByteSize, description);
+}
+
+OSStatus CreateFormatDescription(H265Traits, const uint8_t *const *param_sets,
+                                 const size_t *param_set_sizes,
+                                 CMVideoFormatDescriptionRef *description)
+{
+  return CMVideoFormatDescriptionCreateFromHEVCParameterSets(
+      kCFAllocatorDefault, H265Traits::kParameterSetCount, param_sets,
+      param_set_sizes, kAvccHeaderByteSize, nullptr, description);
+}
+
+template <typename Traits>
+bool AnnexBBufferToCMSampleBuffer(const uint8_t *annexb_buffer,
+                                  size_t annexb_buffer_size,
+                                  CMVideoFormatDescriptionRef video_format,
+                                  CMSampleBufferRef *out_sample_buffer,
+                                  CMMemoryPoolRef memory_pool)
 {
   //  RTC_DCHECK(annexb_buffer);
   //  RTC_DCHECK(out_sample_buffer);
   //  RTC_DCHECK(video_format);
   *out_sample_buffer = nullptr;
 
-  AnnexBBufferReader reader(annexb_buffer, annexb_buffer_size);
-  if (reader.SeekToNextNaluOfType(kSps))
-  {
-    // Buffer contains an SPS NALU - skip it and the following PPS
-    const uint8_t *data;
-    size_t data_len;
-    if (!reader.ReadNalu(&data, &data_len))
-    {
-      //      RTC_LOG(LS_ERROR) << "Failed to read SPS";
-      return false;
-    }
-    if (!reader.ReadNalu(&data, &data_len))
-    {
-      //      RTC_LOG(LS_ERROR) << "Failed to read PPS";
-      return false;
-    }
-  }
-  else
+  // Skip the parameter sets of a keyframe, they are in |video_format|.
+  AnnexBBufferReaderT<Traits> reader(annexb_buffer, annexb_buffer_size);
+  if (!SkipParameterSets(reader))
   {
-    // No SPS NALU - start reading from the first NALU in the buffer
-    reader.SeekToStart();
+    //      RTC_LOG(LS_ERROR) << "Failed to read parameter sets";
+    return false;
   }
+  const size_t avcc_size = reader.AvccBytesRemaining();
 
   // Allocate memory as a block buffer.
   CMBlockBufferRef block_buffer = nullptr;
   CFAllocatorRef block_allocator = CMMemoryPoolGetAllocator(memory_pool);
   OSStatus status = CMBlockBufferCreateWithMemoryBlock(
-      kCFAllocatorDefault, nullptr, reader.BytesRemaining(), block_allocator,
-      nullptr, 0, reader.BytesRemaining(), kCMBlockBufferAssureMemoryNowFlag,
-      &block_buffer);
+      kCFAllocatorDefault, nullptr, avcc_size, block_allocator, nullptr, 0,
+      avcc_size, kCMBlockBufferAssureMemoryNowFlag, &block_buffer);
   if (status != kCMBlockBufferNoErr)
   {
     //    RTC_LOG(LS_ERROR) << "Failed to create block buffer.";
@@ -166,20 +165,12 @@ bool H264AnnexBBufferToCMSampleBuffer(const uint8_t *annexb_buffer,
     CFRelease(contiguous_buffer);
     return false;
   }
-  //  RTC_DCHECK(block_buffer_size == reader.BytesRemaining());
+  //  RTC_DCHECK(block_buffer_size == avcc_size);
 
   // Write Avcc NALUs into block buffer memory.
   AvccBufferWriter writer(reinterpret_cast<uint8_t *>(data_ptr),
                           block_buffer_size);
-  while (reader.BytesRemaining() > 0)
-  {
-    const uint8_t *nalu_data_ptr = nullptr;
-    size_t nalu_data_size = 0;
-    if (reader.ReadNalu(&nalu_data_ptr, &nalu_data_size))
-    {
-      writer.WriteNalu(nalu_data_ptr, nalu_data_size);
-    }
-  }
+  WriteAvccNalus(reader, writer);
 
   // Create sample buffer.
   status = CMSampleBufferCreate(kCFAllocatorDefault, contiguous_buffer, true,
@@ -195,32 +186,25 @@ bool H264AnnexBBufferToCMSampleBuffer(const uint8_t *annexb_buffer,
   return true;
 }
 
-CMVideoFormatDescriptionRef CreateVideoFormatDescription(
-    uint8_t *annexb_buffer, size_t annexb_buffer_size)
+template <typename Traits>
+CMVideoFormatDescriptionRef CreateFormatDescriptionFromAnnexB(
+    const uint8_t *annexb_buffer, size_t annexb_buffer_size)
 {
-  const uint8_t *param_set_ptrs[2] = {};
-  size_t param_set_sizes[2] = {};
-  AnnexBBufferReader reader(annexb_buffer, annexb_buffer_size);
-  // Skip everyting before the SPS, then read the SPS and PPS
-  if (!reader.SeekToNextNaluOfType(kSps))
-  {
-    return nullptr;
-  }
-  if (!reader.ReadNalu(&param_set_ptrs[0], &param_set_sizes[0]))
-  {
-    //    RTC_LOG(LS_ERROR) << "Failed to read SPS";
-    return nullptr;
-  }
-  if (!reader.ReadNalu(&param_set_ptrs[1], &param_set_sizes[1]))
-  {
-    //    RTC_LOG(LS_ERROR) << "Failed to read PPS";
+  const uint8_t *param_set_ptrs[Traits::kParameterSetCount] = {};
+  size_t param_set_sizes[Traits::kParameterSetCount] = {};
+  const std::vector<NaluIndex> nalus =
+      H264::FindNaluIndices(annexb_buffer, annexb_buffer_size);
+  if (!FindParameterSets<Traits>(annexb_buffer, nalus, param_set_ptrs,
+                                 param_set_sizes))
+  {
+    //    RTC_LOG(LS_ERROR) << "Failed to find parameter sets";
     return nullptr;
   }
 
-  // Parse the SPS and PPS into a CMVideoFormatDescription.
+  // Parse the parameter sets into a CMVideoFormatDescription.
   CMVideoFormatDescriptionRef description = nullptr;
-  OSStatus status = CMVideoFormatDescriptionCreateFromH264ParameterSets(
-      kCFAllocatorDefault, 2, param_set_ptrs, param_set_sizes, 4, &description);
+  OSStatus status = CreateFormatDescription(Traits(), param_set_ptrs,
+                                            param_set_sizes, &description);
   if (status != noErr)
   {
     //    RTC_LOG(LS_ERROR) << "Failed to create video format description.";
@@ -229,80 +213,42 @@ CMVideoFormatDescriptionRef CreateVideoFormatDescription(
   return description;
 }
 
-AnnexBBufferReader::AnnexBBufferReader(const uint8_t *annexb_buffer,
-                                       size_t length)
-    : start_(annexb_buffer), length_(length)
-{
-  //  RTC_DCHECK(annexb_buffer);
-  offsets_ = H264::FindNaluIndices(annexb_buffer, length);
-  offset_ = offsets_.begin();
-}
+} // namespace
 
-AnnexBBufferReader::~AnnexBBufferReader() = default;
-
-bool AnnexBBufferReader::ReadNalu(const uint8_t **out_nalu,
-                                  size_t *out_length)
+bool H264AnnexBBufferToCMSampleBuffer(const uint8_t *annexb_buffer,
+                                      size_t annexb_buffer_size,
+                                      CMVideoFormatDescriptionRef video_format,
+                                      CMSampleBufferRef *out_sample_buffer,
+                                      CMMemoryPoolRef memory_pool)
 {
-  //  RTC_DCHECK(out_nalu);
-  //  RTC_DCHECK(out_length);
-  *out_nalu = nullptr;
-  *out_length = 0;
-
-  if (offset_ == offsets_.end())
-  {
-    return false;
-  }
-  *out_nalu = start_ + offset_->payload_start_offset;
-  *out_length = offset_->payload_size;
-  ++offset_;
-  return true;
+  return AnnexBBufferToCMSampleBuffer<H264Traits>(
+      annexb_buffer, annexb_buffer_size, video_format, out_sample_buffer,
+      memory_pool);
 }
 
-size_t AnnexBBufferReader::BytesRemaining() const
+bool H265AnnexBBufferToCMSampleBuffer(const uint8_t *annexb_buffer,
+                                      size_t annexb_buffer_size,
+                                      CMVideoFormatDescriptionRef video_format,
+                                      CMSampleBufferRef *out_sample_buffer,
+                                      CMMemoryPoolRef memory_pool)
 {
-  if (offset_ == offsets_.end())
-  {
-    return 0;
-  }
-  return length_ - offset_->start_offset;
+  return AnnexBBufferToCMSampleBuffer<H265Traits>(
+      annexb_buffer, annexb_buffer_size, video_format, out_sample_buffer,
+      memory_pool);
 }
 
-void AnnexBBufferReader::SeekToStart() { offset_ = offsets_.begin(); }
-
-bool AnnexBBufferReader::SeekToNextNaluOfType(NaluType type)
-{
-  for (; offset_ != offsets_.end(); ++offset_)
-  {
-    if (offset_->payload_size < 1)
-      continue;
-    if (ParseNaluType(*(start_ + offset_->payload_start_offset)) == type)
-      return true;
-  }
-  return false;
-}
-AvccBufferWriter::AvccBufferWriter(uint8_t *const avcc_buffer, size_t length)
-    : start_(avcc_buffer), offset_(0), length_(length)
+CMVideoFormatDescriptionRef CreateVideoFormatDescription(
+    uint8_t *annexb_buffer, size_t annexb_buffer_size)
 {
-  //  RTC_DCHECK(avcc_buffer);
+  return CreateFormatDescriptionFromAnnexB<H264Traits>(annexb_buffer,
+                                                       annexb_buffer_size);
 }
 
-bool AvccBufferWriter::WriteNalu(const uint8_t *data, size_t data_size)
+CMVideoFormatDescriptionRef CreateH265VideoFormatDescription(
+    uint8_t *annexb_buffer, size_t annexb_buffer_size)
 {
-  // Check if we can write this length of data.
-  if (data_size + kAvccHeaderByteSize > BytesRemaining())
-  {
-    return false;
-  }
-  // Write length header, which needs to be big endian.
-  uint32_t big_endian_length = CFSwapInt32HostToBig(data_size);
-  memcpy(start_ + offset_, &big_endian_length, sizeof(big_endian_length));
-  offset_ += sizeof(big_endian_length);
-  // Write data.
-  memcpy(start_ + offset_, data, data_size);
-  offset_ += data_size;
-  return true;
+  return CreateFormatDescriptionFromAnnexB<H265Traits>(annexb_buffer,
+                                                       annexb_buffer_size);
 }
 
-size_t AvccBufferWriter::BytesRemaining() const { return length_ - offset_; }
-
 } // namespace webrtc
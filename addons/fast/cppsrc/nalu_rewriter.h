@@ -15,6 +15,7 @@
 #include <CoreMedia/CoreMedia.h>
 #include <vector>
 
+#include "annexb.h"
 #include "h264_common.h"
 
 using webrtc::H264::NaluIndex;
@@ -45,64 +46,16 @@ bool H264AnnexBBufferToCMSampleBufferSingleNALU(
 CMVideoFormatDescriptionRef CreateVideoFormatDescription(
     uint8_t *annexb_buffer, size_t annexb_buffer_size);
 
-// Helper class for reading NALUs from an RTP Annex B buffer.
-class AnnexBBufferReader final
-{
-public:
-  AnnexBBufferReader(const uint8_t *annexb_buffer, size_t length);
-  ~AnnexBBufferReader();
-  AnnexBBufferReader(const AnnexBBufferReader &other) = delete;
-  void operator=(const AnnexBBufferReader &other) = delete;
-
-  // Returns a pointer to the beginning of the next NALU slice without the
-  // header bytes and its length. Returns false if no more slices remain.
-  bool ReadNalu(const uint8_t **out_nalu, size_t *out_length);
-
-  // Returns the number of unread NALU bytes, including the size of the header.
-  // If the buffer has no remaining NALUs this will return zero.
-  size_t BytesRemaining() const;
-
-  // Reset the reader to start reading from the first NALU
-  void SeekToStart();
-
-  // Seek to the next position that holds a NALU of the desired type,
-  // or the end if no such NALU is found.
-  // Return true if a NALU of the desired type is found, false if we
-  // reached the end instead
-  bool SeekToNextNaluOfType(H264::NaluType type);
-
-private:
-  // Returns the the next offset that contains NALU data.
-  size_t FindNextNaluHeader(const uint8_t *start, size_t length,
-                            size_t offset) const;
-
-  const uint8_t *const start_;
-  std::vector<NaluIndex> offsets_;
-  std::vector<NaluIndex>::iterator offset_;
-  const size_t length_;
-};
-
-// Helper class for writing NALUs using avcc format into a buffer.
-class AvccBufferWriter final
-{
-public:
-  AvccBufferWriter(uint8_t *const avcc_buffer, size_t length);
-  ~AvccBufferWriter() {}
-  AvccBufferWriter(const AvccBufferWriter &other) = delete;
-  void operator=(const AvccBufferWriter &other) = delete;
-
-  // Writes the data slice into the buffer. Returns false if there isn't
-  // enough space left.
-  bool WriteNalu(const uint8_t *data, size_t data_size);
-
-  // Returns the unused bytes in the buffer.
-  size_t BytesRemaining() const;
+// H265 counterparts of the above. The sample buffer is in hvcc format and the
+// format description is created from the vps/sps/pps information.
+bool H265AnnexBBufferToCMSampleBuffer(const uint8_t *annexb_buffer,
+                                      size_t annexb_buffer_size,
+                                      CMVideoFormatDescriptionRef video_format,
+                                      CMSampleBufferRef *out_sample_buffer,
+                                      CMMemoryPoolRef memory_pool);
 
-private:
-  uint8_t *const start_;
-  size_t offset_;
-  const size_t length_;
-};
+CMVideoFormatDescriptionRef CreateH265VideoFormatDescription(
+    uint8_t *annexb_buffer, size_t annexb_buffer_size);
 
 } // namespace webrtc
 
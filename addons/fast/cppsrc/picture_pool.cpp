@@ -0,0 +1,119 @@
+#include "picture_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace fast;
+
+DecodedPicture::DecodedPicture(uint32_t generation, int width, int height)
+    : m_generation(generation), m_width(width), m_height(height), m_refs(0) {}
+
+DecodedPicture::~DecodedPicture() { clearNative(); }
+
+void DecodedPicture::setNative(void *handle, void (*release)(void *)) {
+  clearNative();
+  m_native = handle;
+  m_releaseNative = release;
+}
+
+void DecodedPicture::clearNative() {
+  if (m_native && m_releaseNative) {
+    m_releaseNative(m_native);
+  }
+  m_native = nullptr;
+  m_releaseNative = nullptr;
+}
+
+void DecodedPicture::release() {
+  if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // May drop the last reference to the pool, which then deletes this.
+    const std::shared_ptr<PicturePool> pool = std::move(m_pool);
+    pool->recycle(this);
+  }
+}
+
+std::shared_ptr<PicturePool> PicturePool::create(size_t capacity) {
+  return std::shared_ptr<PicturePool>(new PicturePool(capacity));
+}
+
+PicturePool::PicturePool(size_t capacity)
+    : m_capacity(capacity), m_statistics({capacity, 0, 0, 0, 0, 0, 0, 0}) {}
+
+PicturePool::~PicturePool() = default;
+
+void PicturePool::configure(int width, int height) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_pictures.empty() && width == m_width && height == m_height) {
+    return;
+  }
+
+  // Free pictures go now; the ones still referenced are retired and deleted
+  // by recycle() once released, as their generation no longer matches.
+  for (auto &picture : m_pictures) {
+    if (std::find(m_free.begin(), m_free.end(), picture.get()) ==
+        m_free.end()) {
+      picture.release();
+    }
+  }
+  m_pictures.clear();
+  m_free.clear();
+
+  ++m_generation;
+  m_width = width;
+  m_height = height;
+  for (size_t i = 0; i < m_capacity; ++i) {
+    m_pictures.emplace_back(
+        new DecodedPicture(m_generation, width, height));
+    m_free.push_back(m_pictures.back().get());
+  }
+  m_statistics.pictureAllocations += m_capacity;
+  ++m_statistics.resizes;
+  m_available.notify_all();
+}
+
+PictureRef PicturePool::acquire(int64_t timeout_ms) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_pictures.empty()) {
+    return PictureRef();
+  }
+
+  ++m_statistics.acquisitions;
+  if (m_free.empty()) {
+    ++m_statistics.waits;
+    auto ready = [this] { return !m_free.empty(); };
+    if (timeout_ms < 0) {
+      m_available.wait(lock, ready);
+    } else if (!m_available.wait_for(
+                   lock, std::chrono::milliseconds(timeout_ms), ready)) {
+      ++m_statistics.timeouts;
+      return PictureRef();
+    }
+  }
+
+  DecodedPicture *picture = m_free.back();
+  m_free.pop_back();
+  picture->m_refs.store(1, std::memory_order_relaxed);
+  picture->m_pool = shared_from_this();
+  ++m_statistics.inUse;
+  m_statistics.peakInUse =
+      std::max(m_statistics.peakInUse, m_statistics.inUse);
+  return PictureRef(picture);
+}
+
+PicturePoolStatistics PicturePool::getStatistics() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+void PicturePool::recycle(DecodedPicture *picture) {
+  picture->clearNative();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  --m_statistics.inUse;
+  if (picture->m_generation != m_generation) {
+    delete picture;
+    return;
+  }
+  m_free.push_back(picture);
+  m_available.notify_one();
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace fast {
+class PicturePool;
+
+// A decoded picture, shared between consumers (present, damage tracking,
+// screenshots) without copies. Reference counted intrusively through
+// PictureRef; dropping the last reference hands it back to its pool, which
+// each picture in use keeps alive.
+class DecodedPicture {
+public:
+  ~DecodedPicture();
+  DecodedPicture(const DecodedPicture &other) = delete;
+  void operator=(const DecodedPicture &other) = delete;
+
+  int width() const { return m_width; }
+  int height() const { return m_height; }
+
+  // Platform decoder output (a retained CVPixelBufferRef on macOS). |release|
+  // is called on it when the picture returns to the pool.
+  void *native() const { return m_native; }
+  void setNative(void *handle, void (*release)(void *));
+
+  // Decode order, to tell pictures apart after recycling.
+  uint64_t sequence() const { return m_sequence; }
+  void setSequence(uint64_t sequence) { m_sequence = sequence; }
+
+  void addRef() { m_refs.fetch_add(1, std::memory_order_relaxed); }
+  void release();
+
+private:
+  friend class PicturePool;
+  DecodedPicture(uint32_t generation, int width, int height);
+  void clearNative();
+
+  // Set while the picture is in use.
+  std::shared_ptr<PicturePool> m_pool;
+  const uint32_t m_generation;
+  const int m_width;
+  const int m_height;
+  std::atomic<int> m_refs;
+  void *m_native = nullptr;
+  void (*m_releaseNative)(void *) = nullptr;
+  uint64_t m_sequence = 0;
+};
+
+// Owning handle to a DecodedPicture.
+class PictureRef {
+public:
+  PictureRef() {}
+  PictureRef(const PictureRef &other) : m_picture(other.m_picture) {
+    if (m_picture) {
+      m_picture->addRef();
+    }
+  }
+  PictureRef(PictureRef &&other) : m_picture(other.m_picture) {
+    other.m_picture = nullptr;
+  }
+  ~PictureRef() { reset(); }
+
+  PictureRef &operator=(PictureRef other) {
+    std::swap(m_picture, other.m_picture);
+    return *this;
+  }
+
+  void reset() {
+    if (m_picture) {
+      m_picture->release();
+      m_picture = nullptr;
+    }
+  }
+
+  DecodedPicture *get() const { return m_picture; }
+  DecodedPicture *operator->() const { return m_picture; }
+  explicit operator bool() const { return m_picture != nullptr; }
+
+private:
+  friend class PicturePool;
+  // Adopts the reference the pool took for the caller.
+  explicit PictureRef(DecodedPicture *picture) : m_picture(picture) {}
+
+  DecodedPicture *m_picture = nullptr;
+};
+
+struct PicturePoolStatistics {
+  size_t capacity;
+  size_t inUse;
+  size_t peakInUse;
+  // DecodedPicture wrappers allocated, over every time the pool was
+  // (re)sized. Pixel buffers come from VideoToolbox and are not counted.
+  uint64_t pictureAllocations;
+  uint64_t acquisitions;
+  // Acquisitions that had to wait for a picture, and those that gave up.
+  uint64_t waits;
+  uint64_t timeouts;
+  // Times the pool was (re)sized for new stream dimensions.
+  uint64_t resizes;
+};
+
+// Fixed-size pool of decoded pictures. When every picture is in use,
+// acquire() blocks, which pushes back on the decoder instead of allocating.
+// Pictures handed out hold a reference to the pool, so a PictureRef may
+// outlive whoever created the pool.
+class PicturePool : public std::enable_shared_from_this<PicturePool> {
+public:
+  static std::shared_ptr<PicturePool> create(size_t capacity);
+  ~PicturePool();
+  PicturePool(const PicturePool &other) = delete;
+  void operator=(const PicturePool &other) = delete;
+
+  // Sizes the pictures for a |width| x |height| stream. Only reallocates when
+  // the dimensions change; pictures still held at the old size are freed when
+  // their last reference goes away.
+  void configure(int width, int height);
+
+  // Takes a free picture, waiting up to |timeout_ms| (negative waits forever)
+  // while all are in use. Returns an empty ref on timeout or before
+  // configure().
+  PictureRef acquire(int64_t timeout_ms = -1);
+
+  PicturePoolStatistics getStatistics() const;
+
+private:
+  friend class DecodedPicture;
+  explicit PicturePool(size_t capacity);
+  void recycle(DecodedPicture *picture);
+
+  const size_t m_capacity;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_available;
+  std::vector<std::unique_ptr<DecodedPicture>> m_pictures;
+  std::vector<DecodedPicture *> m_free;
+  int m_width = 0;
+  int m_height = 0;
+  uint32_t m_generation = 0;
+  PicturePoolStatistics m_statistics;
+};
+} // namespace fast
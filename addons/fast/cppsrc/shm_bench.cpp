@@ -0,0 +1,211 @@
+// Two-process check and throughput benchmark for the shared-memory ring.
+//
+// The parent creates the ring and produces synthetic access units (with an
+// IDR-sized burst every GOP); a forked child attaches by name, verifies every
+// AU and reports throughput and producer-to-consumer handoff latency.
+//
+//   shm_bench [--frames N] [--size BYTES] [--capacity BYTES] [--interval-us US]
+//
+// Exits non-zero if the consumer saw a corrupted, lost or reordered AU.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shm_ring.h"
+
+using namespace fast;
+
+namespace {
+struct Options {
+  uint64_t frames = 200000;
+  size_t size = 16 * 1024;
+  size_t capacity = 8 * 1024 * 1024;
+  int64_t intervalMicroseconds = 0;
+};
+
+const int kGopLength = 60;
+const size_t kStampSize = 2 * sizeof(uint64_t);
+// How long the producer waits for space before checking the consumer is still
+// running, so a failed consumer ends the run instead of hanging it.
+const int64_t kReserveTimeoutMicroseconds = 100000;
+
+uint64_t nowNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Deterministic so the consumer can recompute the size of every AU.
+size_t frameSize(const Options &options, uint64_t seq) {
+  if (seq % kGopLength == 0) {
+    return options.size * 8;
+  }
+  const uint64_t hash = (seq * 2654435761u) >> 7;
+  return kStampSize + options.size / 2 + hash % options.size;
+}
+
+uint8_t fillByte(uint64_t seq) { return static_cast<uint8_t>(seq * 31 + 7); }
+
+// Returns true once |child| has exited, storing its wait status.
+bool consumerExited(pid_t child, int *status) {
+  return waitpid(child, status, WNOHANG) == child;
+}
+
+// Stops early, with |exited| set, if the consumer exits before the end.
+int produce(const Options &options, ShmRingProducer &producer, pid_t child,
+            int *status, bool *exited) {
+  for (uint64_t seq = 0; seq < options.frames; ++seq) {
+    const size_t size = frameSize(options, seq);
+    uint8_t *slot;
+    while ((slot = producer.reserve(size, kReserveTimeoutMicroseconds)) ==
+           nullptr) {
+      if (size > producer.maxFrameSize()) {
+        fprintf(stderr, "Failed to reserve %zu bytes\n", size);
+        return 1;
+      }
+      if (consumerExited(child, status)) {
+        *exited = true;
+        fprintf(stderr, "Consumer exited after %llu AUs were produced\n",
+                (unsigned long long)seq);
+        return 1;
+      }
+    }
+    // Touch the whole AU, as a receiver reassembling packets would.
+    memset(slot + kStampSize, fillByte(seq), size - kStampSize);
+    const uint64_t stamp[2] = {seq, nowNanoseconds()};
+    memcpy(slot, stamp, sizeof(stamp));
+    producer.commit(size);
+
+    if (options.intervalMicroseconds > 0) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(options.intervalMicroseconds));
+    }
+  }
+  producer.close();
+  return 0;
+}
+
+double percentile(std::vector<double> &values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  const size_t index = std::min(values.size() - 1,
+                                static_cast<size_t>(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+int consume(const Options &options, const std::string &name) {
+  ShmRingConsumer consumer(name);
+
+  std::vector<double> latencies;
+  latencies.reserve(options.frames);
+  uint64_t expected = 0;
+  uint64_t bytes = 0;
+  uint64_t start = 0;
+
+  uint8_t *data = nullptr;
+  size_t size = 0;
+  while (consumer.read(&data, &size)) {
+    const uint64_t now = nowNanoseconds();
+    uint64_t stamp[2];
+    memcpy(stamp, data, sizeof(stamp));
+    if (stamp[0] != expected || size != frameSize(options, expected) ||
+        data[kStampSize] != fillByte(expected) ||
+        data[size - 1] != fillByte(expected)) {
+      fprintf(stderr, "Corrupted AU: expected #%llu, got #%llu (%zu bytes)\n",
+              (unsigned long long)expected, (unsigned long long)stamp[0],
+              size);
+      return 1;
+    }
+    if (expected == 0) {
+      start = stamp[1];
+    }
+    latencies.push_back(1.0e-3 * (now - stamp[1]));
+    bytes += size;
+    ++expected;
+    consumer.release();
+  }
+
+  if (expected != options.frames) {
+    fprintf(stderr, "Lost AUs: received %llu of %llu\n",
+            (unsigned long long)expected,
+            (unsigned long long)options.frames);
+    return 1;
+  }
+
+  const double seconds = 1.0e-9 * (nowNanoseconds() - start);
+  printf("{\"frames\": %llu, \"seconds\": %.3f, \"frames_per_second\": %.0f, "
+         "\"mb_per_second\": %.1f, \"latency_us\": {\"p50\": %.2f, "
+         "\"p99\": %.2f, \"max\": %.2f}}\n",
+         (unsigned long long)expected, seconds, expected / seconds,
+         bytes / seconds / (1024 * 1024), percentile(latencies, 0.5),
+         percentile(latencies, 0.99), percentile(latencies, 1.0));
+  return 0;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    const long long value = atoll(argv[i + 1]);
+    if (arg == "--frames") {
+      options.frames = value;
+    } else if (arg == "--size") {
+      options.size = value;
+    } else if (arg == "--capacity") {
+      options.capacity = value;
+    } else if (arg == "--interval-us") {
+      options.intervalMicroseconds = value;
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  const std::string name = "/fast_bench_" + std::to_string(getpid());
+  ShmRingProducer producer(name, options.capacity);
+  if (frameSize(options, 0) > producer.maxFrameSize()) {
+    fprintf(stderr, "--capacity too small for --size\n");
+    return 2;
+  }
+
+  pid_t child = fork();
+  if (child < 0) {
+    perror("fork");
+    return 1;
+  }
+  if (child == 0) {
+    int result = 1;
+    try {
+      result = consume(options, name);
+    } catch (const std::exception &e) {
+      fprintf(stderr, "%s\n", e.what());
+    }
+    fflush(stdout);
+    fflush(stderr);
+    _exit(result);
+  }
+
+  int status = 0;
+  bool exited = false;
+  int result = produce(options, producer, child, &status, &exited);
+  if (!exited) {
+    waitpid(child, &status, 0);
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    result = 1;
+  }
+  return result;
+}
@@ -0,0 +1,373 @@
+#include "shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#elif defined(__APPLE__)
+// Darwin's futex equivalent. Not in the public headers, but stable since
+// macOS 10.12 and what libc++ builds std::atomic::wait on.
+extern "C" int __ulock_wait(uint32_t operation, void *addr, uint64_t value,
+                            uint32_t timeout_us);
+extern "C" int __ulock_wake(uint32_t operation, void *addr,
+                            uint64_t wake_value);
+#define UL_COMPARE_AND_WAIT_SHARED 3
+#else
+#error "shm_ring needs futex (Linux) or __ulock_wait (macOS)"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+
+namespace fast {
+struct ShmRingHeader {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint64_t capacity;
+
+  // Written by the producer only.
+  alignas(64) std::atomic<uint64_t> head;
+  std::atomic<uint32_t> dataSeq;
+  std::atomic<uint32_t> consumerWaiting;
+  std::atomic<uint32_t> closed;
+  // Lets the consumer notice a producer that exited without closing.
+  std::atomic<int32_t> producerPid;
+
+  // Written by the consumer only.
+  alignas(64) std::atomic<uint64_t> tail;
+  std::atomic<uint32_t> spaceSeq;
+  std::atomic<uint32_t> producerWaiting;
+};
+} // namespace fast
+
+using namespace fast;
+
+namespace {
+const uint32_t kRingMagic = 0x52494e47; // "RING"
+const uint32_t kRingVersion = 2;
+const size_t kMinCapacity = 4096;
+
+// Every slot starts with this header and is padded to kSlotAlignment, so slot
+// headers never straddle the end of the ring.
+struct SlotHeader {
+  uint32_t size;
+  uint32_t flags;
+};
+const uint32_t kSlotPadding = 1;
+const uint64_t kSlotAlignment = 8;
+
+// Number of polls before a waiting side goes to sleep. Covers the typical
+// producer/consumer handoff without paying for a syscall.
+const int kSpinCount = 4000;
+
+// How often a waiting consumer checks that the producer is still running.
+const int64_t kLivenessCheckMicroseconds = 250000;
+
+static_assert(sizeof(ShmRingHeader) % kSlotAlignment == 0,
+              "ring data must stay aligned");
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "ring atomics must be address free to live in shared memory");
+
+uint64_t alignUp(uint64_t value) {
+  return (value + kSlotAlignment - 1) & ~(kSlotAlignment - 1);
+}
+
+uint64_t slotSize(size_t payload) {
+  return sizeof(SlotHeader) + alignUp(payload);
+}
+
+// Blocks while |word| still holds |expected|, for at most |timeout_us| (or
+// forever if negative). May return early; callers re-check their condition.
+void waitWord(std::atomic<uint32_t> &word, uint32_t expected,
+              int64_t timeout_us) {
+#ifdef __linux__
+  timespec ts;
+  timespec *timeout = nullptr;
+  if (timeout_us >= 0) {
+    ts.tv_sec = timeout_us / 1000000;
+    ts.tv_nsec = (timeout_us % 1000000) * 1000;
+    timeout = &ts;
+  }
+  // Not FUTEX_PRIVATE_FLAG: the word is shared with another process.
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT,
+          expected, timeout, nullptr, 0);
+#else
+  // Shared variant, the word lives in another process's mapping too. A zero
+  // timeout means forever.
+  uint32_t timeout = 0;
+  if (timeout_us >= 0) {
+    timeout = static_cast<uint32_t>(
+        std::min<int64_t>(std::max<int64_t>(timeout_us, 1), UINT32_MAX));
+  }
+  __ulock_wait(UL_COMPARE_AND_WAIT_SHARED, &word, expected, timeout);
+#endif
+}
+
+void wakeWord(std::atomic<uint32_t> &word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1,
+          nullptr, nullptr, 0);
+#else
+  __ulock_wake(UL_COMPARE_AND_WAIT_SHARED, &word, 0);
+#endif
+}
+
+// Waits until |ready| returns true. |seq| is bumped by the other side after
+// every state change and |waiting| tells it whether a wake is needed.
+template <typename Ready>
+bool waitFor(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting,
+             int64_t timeout_us, Ready ready) {
+  for (int i = 0; i < kSpinCount; ++i) {
+    if (ready()) {
+      return true;
+    }
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::microseconds(timeout_us);
+  while (true) {
+    const uint32_t expected = seq.load();
+    waiting.store(1);
+    if (ready()) {
+      waiting.store(0);
+      return true;
+    }
+
+    int64_t remaining = -1;
+    if (timeout_us >= 0) {
+      remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                      deadline - std::chrono::steady_clock::now())
+                      .count();
+      if (remaining <= 0) {
+        waiting.store(0);
+        return false;
+      }
+    }
+    waitWord(seq, expected, remaining);
+    waiting.store(0);
+  }
+}
+
+void *mapRing(int fd, size_t size) {
+  void *mapping =
+      mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Failed to map shared memory ring");
+  }
+  return mapping;
+}
+} // namespace
+
+ShmRingProducer::ShmRingProducer(const std::string &name, size_t capacity)
+    : m_name(name) {
+  size_t rounded = kMinCapacity;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to create shared memory ring: " + name);
+  }
+  m_mappingSize = sizeof(ShmRingHeader) + rounded;
+  if (ftruncate(fd, m_mappingSize) != 0) {
+    ::close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("Failed to size shared memory ring: " + name);
+  }
+  void *mapping = mapRing(fd, m_mappingSize);
+
+  m_header = new (mapping) ShmRingHeader();
+  m_data = static_cast<uint8_t *>(mapping) + sizeof(ShmRingHeader);
+  m_header->version = kRingVersion;
+  m_header->capacity = rounded;
+  m_header->head.store(0);
+  m_header->dataSeq.store(0);
+  m_header->consumerWaiting.store(0);
+  m_header->closed.store(0);
+  m_header->producerPid.store(getpid());
+  m_header->tail.store(0);
+  m_header->spaceSeq.store(0);
+  m_header->producerWaiting.store(0);
+  // Publish last, the consumer refuses to attach before seeing the magic.
+  m_header->magic.store(kRingMagic, std::memory_order_release);
+}
+
+ShmRingProducer::~ShmRingProducer() {
+  close();
+  munmap(m_header, m_mappingSize);
+  shm_unlink(m_name.c_str());
+}
+
+size_t ShmRingProducer::maxFrameSize() const {
+  return m_header->capacity / 2 - sizeof(SlotHeader);
+}
+
+uint8_t *ShmRingProducer::reserve(size_t size, int64_t timeout_us) {
+  if (size > maxFrameSize()) {
+    return nullptr;
+  }
+
+  const uint64_t capacity = m_header->capacity;
+  uint64_t head = m_header->head.load(std::memory_order_relaxed);
+  const uint64_t offset = head & (capacity - 1);
+  const uint64_t slot = slotSize(size);
+  // Keep every AU contiguous: skip the rest of the ring if it does not fit.
+  const uint64_t padding = offset + slot > capacity ? capacity - offset : 0;
+
+  const uint64_t required = padding + slot;
+  ShmRingHeader *header = m_header;
+  if (!waitFor(header->spaceSeq, header->producerWaiting, timeout_us,
+               [header, head, capacity, required] {
+                 return capacity - (head - header->tail.load()) >= required;
+               })) {
+    return nullptr;
+  }
+
+  if (padding > 0) {
+    SlotHeader pad = {0, kSlotPadding};
+    memcpy(m_data + offset, &pad, sizeof(pad));
+    head += padding;
+  }
+  m_reserved = head;
+  return m_data + (head & (capacity - 1)) + sizeof(SlotHeader);
+}
+
+void ShmRingProducer::commit(size_t size) {
+  SlotHeader slot = {static_cast<uint32_t>(size), 0};
+  memcpy(m_data + (m_reserved & (m_header->capacity - 1)), &slot,
+         sizeof(slot));
+
+  m_header->head.store(m_reserved + slotSize(size));
+  m_header->dataSeq.fetch_add(1);
+  if (m_header->consumerWaiting.load()) {
+    wakeWord(m_header->dataSeq);
+  }
+}
+
+bool ShmRingProducer::write(const uint8_t *data, size_t size,
+                            int64_t timeout_us) {
+  uint8_t *slot = reserve(size, timeout_us);
+  if (slot == nullptr) {
+    return false;
+  }
+  memcpy(slot, data, size);
+  commit(size);
+  return true;
+}
+
+void ShmRingProducer::close() {
+  if (m_header->closed.exchange(1)) {
+    return;
+  }
+  m_header->dataSeq.fetch_add(1);
+  wakeWord(m_header->dataSeq);
+}
+
+ShmRingConsumer::ShmRingConsumer(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open shared memory ring: " + name);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Shared memory ring is not initialized: " + name);
+  }
+  m_mappingSize = st.st_size;
+  void *mapping = mapRing(fd, m_mappingSize);
+
+  m_header = static_cast<ShmRingHeader *>(mapping);
+  m_data = static_cast<uint8_t *>(mapping) + sizeof(ShmRingHeader);
+  if (m_header->magic.load(std::memory_order_acquire) != kRingMagic ||
+      m_header->version != kRingVersion ||
+      sizeof(ShmRingHeader) + m_header->capacity > m_mappingSize) {
+    munmap(mapping, m_mappingSize);
+    throw std::runtime_error("Incompatible shared memory ring: " + name);
+  }
+  m_next = m_header->tail.load();
+}
+
+ShmRingConsumer::~ShmRingConsumer() { munmap(m_header, m_mappingSize); }
+
+bool ShmRingConsumer::producerAlive() const {
+  // EPERM still means the process exists.
+  return kill(m_header->producerPid.load(), 0) == 0 || errno != ESRCH;
+}
+
+bool ShmRingConsumer::read(uint8_t **data, size_t *size, int64_t timeout_us) {
+  const uint64_t capacity = m_header->capacity;
+  ShmRingHeader *header = m_header;
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::microseconds(timeout_us);
+  while (true) {
+    const uint64_t tail = m_next;
+    auto ready = [header, tail] {
+      return header->head.load() != tail || header->closed.load();
+    };
+    auto slice = [timeout_us, deadline] {
+      if (timeout_us < 0) {
+        return kLivenessCheckMicroseconds;
+      }
+      const int64_t remaining =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              deadline - std::chrono::steady_clock::now())
+              .count();
+      return std::max<int64_t>(
+          0, std::min(remaining, kLivenessCheckMicroseconds));
+    };
+    // Wait in slices, so a producer that died without closing the ring does
+    // not leave us blocked forever.
+    while (!waitFor(header->dataSeq, header->consumerWaiting, slice(),
+                    ready)) {
+      if (!producerAlive() && !ready()) {
+        throw std::runtime_error(
+            "Shared memory ring producer exited without closing it");
+      }
+      if (timeout_us >= 0 && std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+    }
+    if (m_header->head.load() == tail) {
+      // Closed and drained.
+      m_finished = true;
+      return false;
+    }
+
+    const uint64_t offset = tail & (capacity - 1);
+    SlotHeader slot;
+    memcpy(&slot, m_data + offset, sizeof(slot));
+    if (slot.flags & kSlotPadding) {
+      m_next = tail + (capacity - offset);
+      release();
+      continue;
+    }
+
+    *data = m_data + offset + sizeof(SlotHeader);
+    *size = slot.size;
+    m_next = tail + slotSize(slot.size);
+    return true;
+  }
+}
+
+void ShmRingConsumer::release() {
+  m_header->tail.store(m_next);
+  m_header->spaceSeq.fetch_add(1);
+  if (m_header->producerWaiting.load()) {
+    wakeWord(m_header->spaceSeq);
+  }
+}
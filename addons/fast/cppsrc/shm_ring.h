@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "frame_source.h"
+
+namespace fast {
+// Single-producer/single-consumer ring of variable-length access units in
+// POSIX shared memory, used to hand frames from the receiver process to the
+// player without copies.
+//
+// The producer reserves space directly inside the ring, so the network thread
+// can reassemble an AU in place, and the consumer decodes straight out of the
+// mapping. Each AU occupies one contiguous slot: a slot that would run past the
+// end of the ring is preceded by a padding record and starts at offset 0
+// instead. Waiting sides spin briefly and then block on a futex (Linux) or
+// __ulock_wait (macOS), and are only woken when they announced the wait.
+//
+// The producer records its pid in the ring, and a waiting consumer checks it
+// periodically, so a receiver that crashes (or restarts, which replaces the
+// ring under the same name) makes read() throw instead of blocking forever.
+// Both sides must therefore share a pid namespace.
+//
+// Names follow shm_open rules: a leading '/' and, on macOS, at most 31
+// characters.
+struct ShmRingHeader;
+
+class ShmRingProducer {
+public:
+  // Creates the ring, replacing any stale one with the same name. Consumers
+  // still attached to the replaced ring keep it mapped until they detach.
+  // |capacity| is rounded up to a power of two; a single AU may use at most
+  // half of it.
+  ShmRingProducer(const std::string &name, size_t capacity);
+  ~ShmRingProducer();
+  ShmRingProducer(const ShmRingProducer &other) = delete;
+  void operator=(const ShmRingProducer &other) = delete;
+
+  // Returns |size| writable bytes inside the ring, waiting up to |timeout_us|
+  // (negative waits forever) for the consumer to free space. Returns nullptr
+  // on timeout or if |size| can never fit.
+  uint8_t *reserve(size_t size, int64_t timeout_us = -1);
+
+  // Publishes the AU written into the last reservation. |size| may be smaller
+  // than what was reserved.
+  void commit(size_t size);
+
+  // Copies |data| into the ring. Convenience for callers that already hold the
+  // AU in their own buffer.
+  bool write(const uint8_t *data, size_t size, int64_t timeout_us = -1);
+
+  // Tells the consumer that no more AUs follow. Also done by the destructor.
+  void close();
+
+  size_t maxFrameSize() const;
+
+private:
+  std::string m_name;
+  ShmRingHeader *m_header = nullptr;
+  uint8_t *m_data = nullptr;
+  size_t m_mappingSize = 0;
+  uint64_t m_reserved = 0;
+};
+
+class ShmRingConsumer {
+public:
+  // Attaches to a ring created by ShmRingProducer. Throws std::runtime_error if
+  // it does not exist.
+  explicit ShmRingConsumer(const std::string &name);
+  ~ShmRingConsumer();
+  ShmRingConsumer(const ShmRingConsumer &other) = delete;
+  void operator=(const ShmRingConsumer &other) = delete;
+
+  // Waits up to |timeout_us| (negative waits forever) for the next AU and
+  // points |data| at it inside the ring. Returns false on timeout, or once the
+  // producer closed the ring and everything has been read (see finished()).
+  // Throws std::runtime_error if the producer exited without closing the ring.
+  bool read(uint8_t **data, size_t *size, int64_t timeout_us = -1);
+
+  // Whether read() returned false because the stream ended.
+  bool finished() const { return m_finished; }
+
+  // Frees the AU returned by the last read() for the producer to reuse.
+  void release();
+
+private:
+  bool producerAlive() const;
+
+  ShmRingHeader *m_header = nullptr;
+  uint8_t *m_data = nullptr;
+  size_t m_mappingSize = 0;
+  uint64_t m_next = 0;
+  bool m_finished = false;
+};
+
+// Player-side adapter that feeds AUs from a shared-memory ring. Throws from
+// next() if the producer dies, or if no AU arrives for |timeout_us| (negative
+// waits as long as the producer is alive).
+class ShmFrameSource final : public FrameSource {
+public:
+  explicit ShmFrameSource(const std::string &name, int64_t timeout_us = -1)
+      : m_consumer(name), m_timeout(timeout_us) {}
+
+  bool next(FrameView &frame) override {
+    if (m_consumer.read(&frame.data, &frame.size, m_timeout)) {
+      return true;
+    }
+    if (!m_consumer.finished()) {
+      throw std::runtime_error("Timed out waiting for an access unit");
+    }
+    return false;
+  }
+  void release() override { m_consumer.release(); }
+
+private:
+  ShmRingConsumer m_consumer;
+  const int64_t m_timeout;
+};
+} // namespace fast
@@ -0,0 +1,520 @@
+// Bitrate, GOP and NALU statistics for recorded sessions.
+//
+// Each input is either a frames directory (one access unit per file, as
+// produced by the receiver) or a raw Annex B stream, which is read in chunks
+// and split into access units. Inputs are analyzed in parallel; a summary per
+// input goes to stdout and the per-AU breakdown optionally to a CSV or JSON
+// file.
+//
+//   stream_analyzer [--codec h264|h265] [--fps N] [--window FRAMES]
+//                   [--threads N] [--csv FILE] [--json FILE] <input>...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "annexb.h"
+#include "frame_loader.h"
+
+using namespace fast;
+using webrtc::NaluIndex;
+
+namespace {
+struct Options {
+  std::string codec = "h264";
+  double fps = 30;
+  // Sliding window for the bitrate, in access units. Defaults to one second.
+  size_t window = 0;
+  unsigned threads = 0;
+  std::string csvPath;
+  std::string jsonPath;
+  std::vector<std::string> inputs;
+};
+
+struct AccessUnitStats {
+  // The _au_<index> of a frames directory file, the position in raw streams.
+  uint64_t index;
+  size_t size;
+  uint32_t nalus;
+  uint32_t slices;
+  uint32_t parameterSets;
+  // Emulation prevention bytes (the 03 in 00 00 03) in the NALU payloads.
+  uint32_t emulationBytes;
+  bool keyframe;
+};
+
+struct InputResult {
+  std::string error;
+  std::vector<AccessUnitStats> accessUnits;
+  // Zero-length AU files, which the player skips and so are left out of
+  // accessUnits.
+  size_t emptyFiles = 0;
+  // Gaps in the _au_<index> numbering of a frames directory.
+  size_t missingIndices = 0;
+  // Includes reading the input.
+  double parseSeconds = 0;
+};
+
+// Raw streams are read in chunks of this size, so memory use stays flat
+// however long the recording is.
+const size_t kReadChunkSize = 16 << 20;
+// Largest access unit carried over between chunks. Anything bigger most
+// likely means the input is not an Annex B stream.
+const size_t kMaxAccessUnitSize = 64 << 20;
+
+uint32_t countEmulationBytes(const uint8_t *data, size_t size) {
+  uint32_t count = 0;
+  for (size_t i = 2; i < size;) {
+    // Same skipping as FindNaluIndices: unless data[i] is 0, no 00 00 03
+    // can end at i + 1 or i + 2.
+    if (data[i] == 0) {
+      ++i;
+    } else {
+      if (data[i] == 3 && data[i - 1] == 0 && data[i - 2] == 0) {
+        ++count;
+      }
+      i += 3;
+    }
+  }
+  return count;
+}
+
+template <typename Traits>
+AccessUnitStats analyzeAccessUnit(const uint8_t *buffer, size_t size,
+                                  const NaluIndex *nalus, size_t count) {
+  AccessUnitStats stats = {0, size, static_cast<uint32_t>(count), 0, 0, 0,
+                           false};
+  for (size_t i = 0; i < count; ++i) {
+    const NaluIndex &nalu = nalus[i];
+    if (nalu.payload_size < Traits::kNaluHeaderSize) {
+      continue;
+    }
+    const uint8_t *data = buffer + nalu.payload_start_offset;
+    const typename Traits::NaluType type = Traits::ParseNaluType(data);
+    if (Traits::IsVcl(type)) {
+      ++stats.slices;
+      stats.keyframe |= Traits::IsKeyframe(type);
+    } else if (Traits::ParameterSetIndex(type) >= 0) {
+      ++stats.parameterSets;
+    }
+    stats.emulationBytes += countEmulationBytes(data, nalu.payload_size);
+  }
+  return stats;
+}
+
+bool isDirectory(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Splits |file| into access units a chunk at a time. The access unit at the
+// end of a chunk may continue in the next one, so it is carried over and
+// parsed again together with the next chunk.
+template <typename Traits>
+void analyzeStream(FILE *file, InputResult &result) {
+  std::vector<uint8_t> buffer(kReadChunkSize);
+  size_t held = 0;
+  bool eof = false;
+  while (!eof) {
+    // Only grows when a single access unit spans more than a chunk.
+    if (buffer.size() - held < kReadChunkSize) {
+      buffer.resize(held + kReadChunkSize);
+    }
+    const size_t count =
+        fread(buffer.data() + held, 1, kReadChunkSize, file);
+    held += count;
+    eof = count < kReadChunkSize;
+
+    std::vector<NaluIndex> nalus =
+        webrtc::H264::FindNaluIndices(buffer.data(), held);
+    if (!eof && nalus.size() <= 1) {
+      // Nothing complete yet. Keep the NALU, or without one only what may be
+      // the start of a start code split across chunks.
+      const size_t consumed =
+          nalus.empty() ? held - std::min<size_t>(held, 3)
+                        : nalus[0].start_offset;
+      memmove(buffer.data(), buffer.data() + consumed, held - consumed);
+      held -= consumed;
+      if (held > kMaxAccessUnitSize) {
+        result.error = "access unit over 64 MB, not an Annex B stream?";
+        return;
+      }
+      continue;
+    }
+    // Before the end, the last NALU may be cut short, which would make its
+    // header unreliable for finding access unit boundaries.
+    if (!eof && !nalus.empty()) {
+      nalus.pop_back();
+    }
+    const std::vector<webrtc::AccessUnitIndex> accessUnits =
+        webrtc::FindAccessUnits<Traits>(buffer.data(), held, nalus);
+    size_t complete = accessUnits.size();
+    size_t consumed = held;
+    if (!eof) {
+      --complete;
+      consumed = accessUnits.back().start_offset;
+    }
+
+    for (size_t i = 0; i < complete; ++i) {
+      const webrtc::AccessUnitIndex &au = accessUnits[i];
+      result.accessUnits.push_back(analyzeAccessUnit<Traits>(
+          buffer.data(), au.size, nalus.data() + au.first_nalu,
+          au.nalu_count));
+      result.accessUnits.back().index = result.accessUnits.size() - 1;
+    }
+    memmove(buffer.data(), buffer.data() + consumed, held - consumed);
+    held -= consumed;
+    if (held > kMaxAccessUnitSize) {
+      result.error = "access unit over 64 MB, not an Annex B stream?";
+      return;
+    }
+  }
+
+  if (ferror(file)) {
+    result.error = "read failed";
+  } else if (result.accessUnits.empty()) {
+    result.error = "no access units found";
+  }
+}
+
+// Reads the AU files of a frames directory one at a time, in index order.
+template <typename Traits>
+void analyzeDirectory(const Options &options, const std::string &path,
+                      InputResult &result) {
+  const std::vector<FrameFile> files = listFrames(path, options.codec);
+  if (files.empty()) {
+    result.error = "no frames found";
+    return;
+  }
+
+  std::vector<uint8_t> buffer;
+  result.accessUnits.reserve(files.size());
+  for (size_t i = 1; i < files.size(); ++i) {
+    result.missingIndices += files[i].index - files[i - 1].index - 1;
+  }
+  for (const FrameFile &entry : files) {
+    const std::string name = path + "/" + entry.name;
+    FILE *file = fopen(name.c_str(), "rb");
+    struct stat st;
+    if (file == NULL || fstat(fileno(file), &st) != 0) {
+      if (file) {
+        fclose(file);
+      }
+      result.error = "cannot open " + entry.name;
+      return;
+    }
+    buffer.resize(st.st_size);
+    const size_t size = fread(buffer.data(), 1, buffer.size(), file);
+    const bool failed = ferror(file);
+    fclose(file);
+    if (failed || size != buffer.size()) {
+      result.error = "read failed: " + entry.name;
+      return;
+    }
+
+    if (size == 0) {
+      ++result.emptyFiles;
+      continue;
+    }
+    const std::vector<NaluIndex> nalus =
+        webrtc::H264::FindNaluIndices(buffer.data(), size);
+    result.accessUnits.push_back(analyzeAccessUnit<Traits>(
+        buffer.data(), size, nalus.data(), nalus.size()));
+    result.accessUnits.back().index = entry.index;
+  }
+  if (result.accessUnits.empty()) {
+    result.error = "no access units found";
+  }
+}
+
+template <typename Traits>
+void analyzeInput(const Options &options, const std::string &path,
+                  InputResult &result) {
+  const auto start = std::chrono::steady_clock::now();
+  if (isDirectory(path)) {
+    analyzeDirectory<Traits>(options, path, result);
+    result.parseSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+    return;
+  }
+
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    result.error = "cannot open";
+    return;
+  }
+  analyzeStream<Traits>(file, result);
+  fclose(file);
+  result.parseSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+}
+
+void printSummary(const Options &options, const std::string &path,
+                  const InputResult &result) {
+  if (!result.error.empty()) {
+    printf("%s: %s\n", path.c_str(), result.error.c_str());
+    return;
+  }
+
+  const std::vector<AccessUnitStats> &aus = result.accessUnits;
+  std::vector<size_t> sizes;
+  sizes.reserve(aus.size());
+  uint64_t bytes = 0, emulation = 0;
+  size_t keyframes = 0, maxSlices = 0, slices = 0;
+  size_t firstKeyframe = 0, lastKeyframe = 0;
+  size_t minGop = 0, maxGop = 0, gops = 0;
+  for (size_t i = 0; i < aus.size(); ++i) {
+    const AccessUnitStats &au = aus[i];
+    sizes.push_back(au.size);
+    bytes += au.size;
+    emulation += au.emulationBytes;
+    slices += au.slices;
+    maxSlices = std::max<size_t>(maxSlices, au.slices);
+    if (au.keyframe) {
+      if (keyframes > 0) {
+        const size_t gop = i - lastKeyframe;
+        minGop = gops == 0 ? gop : std::min(minGop, gop);
+        maxGop = std::max(maxGop, gop);
+        ++gops;
+      } else {
+        firstKeyframe = i;
+      }
+      lastKeyframe = i;
+      ++keyframes;
+    }
+  }
+  std::sort(sizes.begin(), sizes.end());
+  auto sizeAt = [&sizes](double p) {
+    return sizes[std::min(sizes.size() - 1,
+                          static_cast<size_t>(p * sizes.size()))];
+  };
+
+  // Sliding window bitrate over |window| consecutive AUs at |fps|.
+  // At least one AU, even for --fps below 0.5.
+  const size_t window = std::min(
+      aus.size(),
+      options.window > 0
+          ? options.window
+          : std::max<size_t>(1, static_cast<size_t>(options.fps + 0.5)));
+  uint64_t windowBytes = 0;
+  uint64_t minWindow = UINT64_MAX, maxWindow = 0;
+  for (size_t i = 0; i < aus.size(); ++i) {
+    windowBytes += aus[i].size;
+    if (i >= window) {
+      windowBytes -= aus[i - window].size;
+    }
+    if (i + 1 >= window) {
+      minWindow = std::min(minWindow, windowBytes);
+      maxWindow = std::max(maxWindow, windowBytes);
+    }
+  }
+  const double kbpsPerWindowByte = 8.0e-3 * options.fps / window;
+
+  printf("%s\n", path.c_str());
+  printf("  access units:     %zu (%.1f s at %.0f fps)", aus.size(),
+         aus.size() / options.fps, options.fps);
+  if (result.emptyFiles > 0) {
+    printf(", %zu empty skipped", result.emptyFiles);
+  }
+  if (result.missingIndices > 0) {
+    printf(", %zu missing", result.missingIndices);
+  }
+  printf("\n");
+  printf("  size (bytes):     mean %.0f, p50 %zu, p95 %zu, max %zu\n",
+         static_cast<double>(bytes) / aus.size(), sizeAt(0.5), sizeAt(0.95),
+         sizes.back());
+  printf("  bitrate (kbps):   mean %.0f, %zu-AU window min %.0f, max %.0f\n",
+         8.0e-3 * bytes * options.fps / aus.size(), window,
+         minWindow * kbpsPerWindowByte, maxWindow * kbpsPerWindowByte);
+  printf("  keyframes:        %zu", keyframes);
+  if (gops > 0) {
+    printf(", interval mean %.1f, min %zu, max %zu AUs",
+           static_cast<double>(lastKeyframe - firstKeyframe) / gops, minGop,
+           maxGop);
+  }
+  printf("\n");
+  printf("  slices per AU:    mean %.2f, max %zu\n",
+         static_cast<double>(slices) / aus.size(), maxSlices);
+  printf("  emulation bytes:  %llu (%.3f%% of stream)\n",
+         (unsigned long long)emulation, 100.0 * emulation / bytes);
+  printf("  parse throughput: %.0f MB/s\n",
+         result.parseSeconds > 0
+             ? bytes / result.parseSeconds / (1024 * 1024)
+             : 0);
+}
+
+// Quotes |field| if it holds a separator, quote or line break.
+std::string csvField(const std::string &field) {
+  if (field.find_first_of(",\"\r\n") == std::string::npos) {
+    return field;
+  }
+  std::string quoted = "\"";
+  for (char c : field) {
+    if (c == '"') {
+      quoted += '"';
+    }
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+// Quotes and escapes |value| as a JSON string.
+std::string jsonString(const std::string &value) {
+  std::string escaped = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped + "\"";
+}
+
+void writeCsv(const Options &options, const std::vector<InputResult> &results) {
+  FILE *file = fopen(options.csvPath.c_str(), "w");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", options.csvPath.c_str());
+    return;
+  }
+  fprintf(file,
+          "input,au,size,nalus,slices,parameter_sets,emulation_bytes,"
+          "keyframe\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const std::string input = csvField(options.inputs[i]);
+    const auto &aus = results[i].accessUnits;
+    for (size_t j = 0; j < aus.size(); ++j) {
+      fprintf(file, "%s,%llu,%zu,%u,%u,%u,%u,%d\n", input.c_str(),
+              (unsigned long long)aus[j].index, aus[j].size, aus[j].nalus, aus[j].slices,
+              aus[j].parameterSets, aus[j].emulationBytes, aus[j].keyframe);
+    }
+  }
+  fclose(file);
+}
+
+void writeJson(const Options &options,
+               const std::vector<InputResult> &results) {
+  FILE *file = fopen(options.jsonPath.c_str(), "w");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", options.jsonPath.c_str());
+    return;
+  }
+  fprintf(file, "{\"fps\": %g, \"inputs\": [", options.fps);
+  for (size_t i = 0; i < results.size(); ++i) {
+    fprintf(file, "%s\n  {\"path\": %s, \"access_units\": [",
+            i > 0 ? "," : "", jsonString(options.inputs[i]).c_str());
+    const auto &aus = results[i].accessUnits;
+    for (size_t j = 0; j < aus.size(); ++j) {
+      fprintf(file,
+              "%s\n    {\"au\": %llu, \"size\": %zu, \"nalus\": %u, "
+              "\"slices\": %u, "
+              "\"parameter_sets\": %u, \"emulation_bytes\": %u, "
+              "\"keyframe\": %s}",
+              j > 0 ? "," : "", (unsigned long long)aus[j].index,
+              aus[j].size, aus[j].nalus, aus[j].slices,
+              aus[j].parameterSets, aus[j].emulationBytes,
+              aus[j].keyframe ? "true" : "false");
+    }
+    fprintf(file, "]}");
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      options.inputs.push_back(arg);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    if (arg == "--codec") {
+      options.codec = value;
+    } else if (arg == "--fps") {
+      options.fps = atof(value);
+    } else if (arg == "--window") {
+      options.window = atoi(value);
+    } else if (arg == "--threads") {
+      options.threads = atoi(value);
+    } else if (arg == "--csv") {
+      options.csvPath = value;
+    } else if (arg == "--json") {
+      options.jsonPath = value;
+    } else {
+      return false;
+    }
+  }
+  return !options.inputs.empty() && options.fps > 0 &&
+         (options.codec == "h264" || options.codec == "h265");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr,
+            "Usage: %s [--codec h264|h265] [--fps N] [--window FRAMES] "
+            "[--threads N] [--csv FILE] [--json FILE] <input>...\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<InputResult> results(options.inputs.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&options, &results, &next] {
+    for (size_t i = next++; i < options.inputs.size(); i = next++) {
+      if (options.codec == "h265") {
+        analyzeInput<webrtc::H265Traits>(options, options.inputs[i],
+                                         results[i]);
+      } else {
+        analyzeInput<webrtc::H264Traits>(options, options.inputs[i],
+                                         results[i]);
+      }
+    }
+  };
+
+  unsigned threads = options.threads > 0
+                         ? options.threads
+                         : std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min<unsigned>(threads, options.inputs.size());
+  std::vector<std::thread> pool;
+  for (unsigned i = 1; i < threads; ++i) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+
+  bool failed = false;
+  for (size_t i = 0; i < results.size(); ++i) {
+    printSummary(options, options.inputs[i], results[i]);
+    failed |= !results[i].error.empty();
+  }
+  if (!options.csvPath.empty()) {
+    writeCsv(options, results);
+  }
+  if (!options.jsonPath.empty()) {
+    writeJson(options, results);
+  }
+  return failed ? 1 : 0;
+}
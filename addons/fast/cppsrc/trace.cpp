@@ -0,0 +1,174 @@
+#include "trace.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "benchmark.h"
+
+using namespace fast;
+
+namespace {
+const char kTraceMagic[4] = {'F', 'T', 'R', 'C'};
+
+// How long before the deadline we stop sleeping and start spinning.
+const auto kSpinMargin = std::chrono::microseconds(1500);
+
+// Large enough that a capture session rarely hits the disk per AU.
+const size_t kWriteBufferSize = 1 << 20;
+} // namespace
+
+TraceWriter::TraceWriter(const std::string &path) {
+  m_file = fopen(path.c_str(), "wb");
+  if (m_file == NULL) {
+    throw std::runtime_error("Failed to open trace for writing: " + path);
+  }
+  setvbuf(m_file, NULL, _IOFBF, kWriteBufferSize);
+
+  if (fwrite(kTraceMagic, sizeof(kTraceMagic), 1, m_file) != 1 ||
+      fwrite(&kTraceVersion, sizeof(kTraceVersion), 1, m_file) != 1) {
+    fclose(m_file);
+    throw std::runtime_error("Failed to write trace header: " + path);
+  }
+}
+
+TraceWriter::~TraceWriter() {
+  if (m_file) {
+    fclose(m_file);
+  }
+}
+
+void TraceWriter::write(const uint8_t *data, size_t size) {
+  write(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count(),
+        data, size);
+}
+
+void TraceWriter::write(uint64_t arrivalMicroseconds, const uint8_t *data,
+                        size_t size) {
+  if (size > UINT32_MAX) {
+    throw std::runtime_error("Access unit too large for a trace record");
+  }
+  if (!m_started) {
+    m_origin = arrivalMicroseconds;
+    m_started = true;
+  }
+  // Socket timestamps can step back slightly; never go before the first AU.
+  const uint64_t arrival =
+      arrivalMicroseconds > m_origin ? arrivalMicroseconds - m_origin : 0;
+  const uint32_t size32 = static_cast<uint32_t>(size);
+  if (fwrite(&arrival, sizeof(arrival), 1, m_file) != 1 ||
+      fwrite(&size32, sizeof(size32), 1, m_file) != 1 ||
+      (size > 0 && fwrite(data, size, 1, m_file) != 1)) {
+    throw std::runtime_error("Failed to write trace record");
+  }
+}
+
+void TraceWriter::flush() {
+  if (fflush(m_file) != 0) {
+    throw std::runtime_error("Failed to flush trace");
+  }
+}
+
+std::vector<TraceFrame> fast::loadTrace(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    throw std::runtime_error("Failed to open trace: " + path);
+  }
+
+  char magic[4] = {};
+  uint32_t version = 0;
+  if (fread(magic, sizeof(magic), 1, file) != 1 ||
+      fread(&version, sizeof(version), 1, file) != 1 ||
+      memcmp(magic, kTraceMagic, sizeof(magic)) != 0 ||
+      version != kTraceVersion) {
+    fclose(file);
+    throw std::runtime_error("Not a trace file: " + path);
+  }
+
+  std::vector<TraceFrame> frames;
+  uint64_t origin = 0;
+  while (true) {
+    uint64_t arrival = 0;
+    uint32_t size = 0;
+    if (fread(&arrival, sizeof(arrival), 1, file) != 1) {
+      break;
+    }
+    if (fread(&size, sizeof(size), 1, file) != 1) {
+      fclose(file);
+      throw std::runtime_error("Truncated trace record header: " + path);
+    }
+    // Traces from other writers may hold absolute times; the pacer expects
+    // them relative to the first AU.
+    if (frames.empty()) {
+      origin = arrival;
+    }
+    arrival = arrival > origin ? arrival - origin : 0;
+    TraceFrame frame = {arrival, std::vector<uint8_t>(size)};
+    if (size > 0 && fread(frame.data.data(), size, 1, file) != 1) {
+      fclose(file);
+      throw std::runtime_error("Truncated trace record: " + path);
+    }
+    frames.push_back(std::move(frame));
+  }
+  fclose(file);
+
+  return frames;
+}
+
+ReplayPacer::ReplayPacer(double speed) : m_speed(speed) { start(); }
+
+void ReplayPacer::start() { m_start = std::chrono::steady_clock::now(); }
+
+int64_t ReplayPacer::waitUntil(uint64_t arrivalMicroseconds) {
+  if (m_speed <= 0) {
+    return 0;
+  }
+
+  const auto deadline =
+      m_start + std::chrono::microseconds(
+                    static_cast<int64_t>(arrivalMicroseconds / m_speed));
+  if (std::chrono::steady_clock::now() < deadline - kSpinMargin) {
+    std::this_thread::sleep_until(deadline - kSpinMargin);
+  }
+  auto now = std::chrono::steady_clock::now();
+  while (now < deadline) {
+    now = std::chrono::steady_clock::now();
+  }
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(now - deadline)
+      .count();
+}
+
+ReplayResult fast::replayTrace(std::vector<TraceFrame> &frames,
+                               BenchmarkDecoder &decoder, double speed) {
+  ReplayResult result = {frames.size(), 0, 0, 0, 0};
+  if (frames.empty()) {
+    return result;
+  }
+
+  std::vector<int64_t> lateness;
+  lateness.reserve(frames.size());
+  ReplayPacer pacer(speed);
+  for (auto &frame : frames) {
+    lateness.push_back(pacer.waitUntil(frame.arrivalMicroseconds));
+    if (!decoder.decode(frame.data.data(), frame.data.size())) {
+      ++result.failures;
+    }
+  }
+
+  int64_t total = 0;
+  for (int64_t value : lateness) {
+    total += value;
+  }
+  std::sort(lateness.begin(), lateness.end());
+  result.meanLateness = 1.0e-3 * total / lateness.size();
+  result.p99Lateness =
+      1.0e-3 * lateness[std::min(lateness.size() - 1,
+                                 static_cast<size_t>(0.99 * lateness.size()))];
+  result.maxLateness = 1.0e-3 * lateness.back();
+  return result;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace fast {
+class BenchmarkDecoder;
+
+// A trace is a capture of access units together with the time they arrived
+// from the network, so that bursty delivery (IDR bursts, Wi-Fi jitter, frame
+// clumping) can be replayed into the player exactly as it happened.
+//
+// File layout (host byte order, little endian on every platform we ship):
+//   header: char magic[4] = "FTRC", uint32_t version
+//   record: uint64_t arrival_us, uint32_t size, uint8_t data[size]
+// arrival_us is relative to the first captured access unit.
+const uint32_t kTraceVersion = 1;
+
+struct TraceFrame {
+  uint64_t arrivalMicroseconds;
+  std::vector<uint8_t> data;
+};
+
+// Appends access units to a trace file. Meant to be called from the receiving
+// thread right after an AU has been reassembled; not thread safe.
+class TraceWriter {
+public:
+  explicit TraceWriter(const std::string &path);
+  ~TraceWriter();
+  TraceWriter(const TraceWriter &other) = delete;
+  void operator=(const TraceWriter &other) = delete;
+
+  // Records an AU stamped with the current time.
+  void write(const uint8_t *data, size_t size);
+  // Records an AU with an explicit arrival time in microseconds on any
+  // monotonic clock, e.g. a socket timestamp. Times are stored relative to the
+  // first AU written. Throws std::runtime_error if |size| does not fit a
+  // record or the write fails.
+  void write(uint64_t arrivalMicroseconds, const uint8_t *data, size_t size);
+  void flush();
+
+private:
+  FILE *m_file = nullptr;
+  uint64_t m_origin = 0;
+  bool m_started = false;
+};
+
+// Reads a whole trace into memory, so disk access does not disturb the replay
+// timing. Arrival times are rebased so the first AU arrives at 0. Throws
+// std::runtime_error if the file is missing or malformed.
+std::vector<TraceFrame> loadTrace(const std::string &path);
+
+// Reproduces the arrival timing of a trace. |speed| scales the timeline: 2.0
+// replays twice as fast, 0.5 at half speed and 0 disables pacing.
+class ReplayPacer {
+public:
+  explicit ReplayPacer(double speed);
+
+  void start();
+  // Blocks until |arrivalMicroseconds| is due and returns how late we woke up,
+  // in microseconds. Sleeps most of the wait and spins the last stretch, as
+  // the OS scheduler alone only gets within a millisecond or so.
+  int64_t waitUntil(uint64_t arrivalMicroseconds);
+
+private:
+  double m_speed;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+struct ReplayResult {
+  size_t frames;
+  size_t failures;
+  // How late AUs were handed to the decoder, in milliseconds. Includes time
+  // spent decoding earlier AUs, so large values mean the decoder could not keep
+  // up rather than a pacing error.
+  double meanLateness;
+  double p99Lateness;
+  double maxLateness;
+};
+
+// Feeds |frames| to |decoder| with their recorded timing, scaled by |speed| as
+// for ReplayPacer. The AUs are decoded in place.
+ReplayResult replayTrace(std::vector<TraceFrame> &frames,
+                         BenchmarkDecoder &decoder, double speed);
+} // namespace fast
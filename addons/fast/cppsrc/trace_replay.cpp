@@ -0,0 +1,65 @@
+// Headless trace replay. Feeds a captured trace through the player's frame
+// pipeline with its recorded arrival timing, without VideoToolbox, so an
+// incident can be reproduced on any machine.
+//
+//   trace_replay <trace> [--speed X] [--codec h264|h265]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "trace.h"
+
+using namespace fast;
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <trace> [--speed X] [--codec h264|h265]\n",
+            argv[0]);
+    return 2;
+  }
+
+  double speed = 1.0;
+  std::string codec = "h264";
+  for (int i = 2; i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    if (arg == "--speed") {
+      speed = atof(argv[i + 1]);
+    } else if (arg == "--codec") {
+      codec = argv[i + 1];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  std::vector<TraceFrame> frames;
+  try {
+    frames = loadTrace(argv[1]);
+  } catch (const std::exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  printf("Replaying %zu frames at %.2fx\n", frames.size(), speed);
+  ReplayResult result;
+  if (codec == "h265") {
+    H265HeadlessDecoder decoder;
+    result = replayTrace(frames, decoder, speed);
+  } else {
+    HeadlessDecoder decoder;
+    result = replayTrace(frames, decoder, speed);
+  }
+  printf("Replay lateness: mean %.3f ms, p99 %.3f ms, max %.3f ms\n",
+         result.meanLateness, result.p99Lateness, result.maxLateness);
+  if (result.failures > 0) {
+    printf("%zu of %zu frames failed to convert\n", result.failures,
+           result.frames);
+    return 1;
+  }
+  return 0;
+}